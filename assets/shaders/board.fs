@@ -0,0 +1,27 @@
+#version 330
+
+// Board shader, draws a whole board as one quad. texture0 has one texel per tile holding the
+// tile byte in storage order, with row zero at storage row first. The palette maps a tile byte
+// to its color and the sprite is the tile texture.
+
+in vec2 fragTexCoord;
+in vec4 fragColor;
+
+uniform sampler2D texture0;
+uniform sampler2D palette;
+uniform sampler2D sprite;
+uniform vec2 grid;
+uniform float first;
+
+out vec4 finalColor;
+
+void main() {
+   vec2 cell = fragTexCoord * grid;
+   vec2 texel = vec2(floor(cell.x), mod(floor(cell.y) + first, grid.y));
+   float tile = floor(texture(texture0, (texel + 0.5) / grid).r * 255.0 + 0.5);
+   if (tile < 0.5) {
+      discard;
+   }
+   vec4 color = texture(palette, vec2((tile + 0.5) / 256.0, 0.5));
+   finalColor = texture(sprite, fract(cell)) * color * fragColor;
+}
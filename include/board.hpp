@@ -0,0 +1,73 @@
+#ifndef BOARD_HPP
+#define BOARD_HPP
+
+// Includes
+
+#include <memory>
+#include <vector>
+
+// Tile, one byte per cell. Zero is empty, garbage and border are tags and any other value is
+// a piece color, its index in the palette plus one.
+
+struct Tile {
+   enum : unsigned char { off = 0, garbage = 254, border = 255 };
+};
+
+// Board, the tiles of one grid in a single allocation. Copies share the tiles until one of
+// them writes, so snapshotting a board costs a reference count. Rows are a ring over the
+// storage, so raising the stack or removing a row turns the ring instead of moving every row.
+
+class Board {
+   std::shared_ptr<std::vector<unsigned char>> cells;
+   int first = 0; // Storage row of row zero
+
+   void unshare();
+
+   int slot(int y) const {
+      int s = y + first;
+      return (s < height ? s : s - height);
+   }
+
+   unsigned char* slot_row(int y) {
+      return cells->data() + slot(y) * width;
+   }
+
+public:
+   int width = 0, height = 0;
+
+   Board() = default;
+   Board(int width, int height);
+
+   unsigned char operator()(int x, int y) const {
+      return (*cells)[slot(y) * width + x];
+   }
+
+   const unsigned char* row(int y) const {
+      return cells->data() + slot(y) * width;
+   }
+
+   unsigned char* edit_row(int y) {
+      unshare();
+      return slot_row(y);
+   }
+
+   void set(int x, int y, unsigned char tile) {
+      edit_row(y)[x] = tile;
+   }
+
+   // Storage, the rows in storage order starting with first_row()
+
+   const unsigned char* storage() const {
+      return cells->data();
+   }
+
+   int first_row() const {
+      return first;
+   }
+
+   unsigned char* rise();
+   void remove_row(int y);
+   bool shares_tiles(const Board& other) const;
+};
+
+#endif
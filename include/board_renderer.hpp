@@ -0,0 +1,32 @@
+#ifndef BOARD_RENDERER_HPP
+#define BOARD_RENDERER_HPP
+
+// Includes
+
+#include "board.hpp"
+#include <raylib.h>
+#include <vector>
+
+// Board renderer, draws a whole board as one quad. Each board is kept in a texture with one
+// texel per tile, uploaded only when its tiles change, and a shader looks up the tile's color
+// and samples the tile sprite. Without shader support ready() is false and callers draw the
+// tiles one by one.
+
+class BoardRenderer {
+   Shader shader {};
+   Texture palette_tx {};
+   std::vector<Texture> textures;
+   std::vector<Board> uploaded;
+   int palette_loc = -1, sprite_loc = -1, grid_loc = -1, first_loc = -1;
+
+public:
+   BoardRenderer();
+   BoardRenderer(const BoardRenderer&) = delete;
+   BoardRenderer& operator=(const BoardRenderer&) = delete;
+   ~BoardRenderer();
+
+   bool ready() const;
+   void draw(int slot, const Board& board, const Texture& sprite, const Vector2& position, const Vector2& tile);
+};
+
+#endif
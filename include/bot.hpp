@@ -0,0 +1,91 @@
+#ifndef BOT_HPP
+#define BOT_HPP
+
+// Includes
+
+#include "placement.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Structs
+
+// Bot weights, multiplied with the board features to score a board
+
+struct BotWeights {
+   float height = -.51f, holes = -.36f, bumpiness = -.18f, wells = -.1f, lines = .76f;
+};
+
+// Bot level, how long the bot may think and how fast it presses keys
+
+struct BotLevel {
+   float time_budget = .1f, input_interval = .1f;
+   int node_budget = 2000, beam_width = 8;
+};
+
+// Search functions
+
+std::uint64_t hash_board(const PlacementBoard& board);
+float evaluate_board(const PlacementBoard& board, const BotWeights& weights);
+
+using TranspositionTable = std::unordered_map<std::uint64_t, float>;
+
+std::optional<Placement> find_best_placement(const PlacementBoard& board, const Tetromino& current, const Tetromino& next, const Vector2& spawn,
+   const BotWeights& weights, const BotLevel& level, TranspositionTable& table);
+
+BotLevel get_bot_level(int difficulty);
+
+// Place best, moves the player's piece straight to the best placement and returns the hard
+// drop locking it, or no input when the piece has nowhere to go. For bots that play without
+// pressing keys one at a time.
+
+Input place_best(Simulation& sim, Player& player, const BotWeights& weights, const BotLevel& level, TranspositionTable& table);
+
+// Spread weights, the default weights with normal noise on each, like a population being tuned
+
+BotWeights spread_weights(std::mt19937& rng);
+
+// Bot, plays one player by searching on a worker thread and replaying the found placement's
+// key presses at its level's input speed
+
+class Bot {
+   struct Request {
+      PlacementBoard board;
+      Tetromino current, next;
+      Vector2 spawn;
+      int id = 0;
+   };
+
+   std::thread worker;
+   std::mutex mutex;
+   std::condition_variable requested;
+   std::optional<Request> request;
+   std::optional<Placement> result;
+   int result_id = -1;
+   bool running = true;
+
+   BotWeights weights;
+   BotLevel level;
+   std::vector<Input::Key> plan;
+   int plan_index = 0, pieces = -1;
+   float input_timer = 0.f;
+   bool releasing = false, waiting = false;
+
+   void run();
+
+public:
+   Bot(const BotLevel& level, const BotWeights& weights = {});
+   Bot(const Bot&) = delete;
+   Bot& operator=(const Bot&) = delete;
+   ~Bot();
+
+   Input update(const Simulation& sim, const Player& player, float dt);
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef BROADCAST_HPP
+#define BROADCAST_HPP
+
+// Includes
+
+#include "util/bytes.hpp"
+#include "simulation.hpp"
+#include <vector>
+
+// Broadcast frame, the part of a simulation a spectator needs to render it
+
+struct BroadcastFrame {
+   struct Piece {
+      Tetromino tetromino;
+      unsigned char color = Tile::off;
+      Vector2 pos;
+      int preview_y = 0;
+      bool waiting = false;
+   };
+
+   std::vector<Board> tiles, next_tiles;
+   std::vector<Piece> pieces;
+   Vector2 grid;
+   int score = 0, level = 0, player_count = 0;
+   bool versus = false, lost = false, left_win = false;
+};
+
+// Encoding functions. A frame encoded without a previous frame is a keyframe holding every
+// row, otherwise only rows that changed since the previous frame are written.
+
+BroadcastFrame make_broadcast_frame(const Simulation& sim);
+std::vector<unsigned char> encode_broadcast_frame(const BroadcastFrame& frame, const BroadcastFrame* previous);
+bool apply_broadcast_frame(ByteReader& reader, Simulation& sim);
+
+// Broadcast functions, fan-out to subscribers happens on a background thread
+
+void start_broadcast(int port);
+void stop_broadcast();
+bool is_broadcasting();
+void broadcast_simulation(const Simulation& sim);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef CAPTURE_HPP
+#define CAPTURE_HPP
+
+// Includes
+
+#include <string>
+
+// Capture config. A path ending in .raw is a raw container of frames, each an 8 byte width
+// and height followed by RGBA rows top to bottom, and any other path is a directory of
+// numbered PNG files.
+
+struct CaptureConfig {
+   std::string path;
+   int queue_frames = 16, threads = 0;
+   bool block = false; // Wait for a free frame instead of dropping one when the queue is full
+};
+
+// Capture functions. capture_frame() is called after a frame is drawn and before it is
+// shown. It starts an asynchronous read of the frame into a pixel buffer and hands a frame
+// that finished reading to the encoding workers, so the frame never waits on the GPU or on
+// encoding. Frames are dropped, and counted, when no pixel buffer or queue slot is free.
+
+void start_capture(const CaptureConfig& config);
+void stop_capture();
+void capture_frame();
+bool capture_running();
+
+#endif
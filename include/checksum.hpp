@@ -0,0 +1,52 @@
+#ifndef CHECKSUM_HPP
+#define CHECKSUM_HPP
+
+// Includes
+
+#include "board.hpp"
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class Simulation;
+
+// State checksum, one hash per part of a simulation, so two runs that part can be told apart
+// by what parted. Floats are hashed by their bits, so a timer that is off in the last bit
+// counts.
+
+struct StateChecksum {
+   enum Field : std::uint8_t { tiles, garbage, pieces, positions, timers, counters, rng, fields };
+
+   std::array<std::uint64_t, fields> hashes {};
+
+   std::uint64_t combined() const;
+};
+
+// Checksummer, hashes a simulation once a tick. Boards are hashed again only once their tiles
+// no longer share storage with the copy hashed last, so a tick that writes no tiles costs the
+// players, the counters and the RNG.
+
+class Checksummer {
+   std::vector<Board> hashed;
+   std::vector<std::uint64_t> board_hashes;
+
+public:
+   StateChecksum update(const Simulation& sim);
+};
+
+// Checksum log functions. Each logged tick is written with its field hashes and a chain hash
+// over every tick logged before it, so two logs that part once stay parted.
+
+void start_checksum_log(const std::string& file);
+void stop_checksum_log();
+bool is_logging_checksums();
+void log_checksum(std::uint64_t tick, const StateChecksum& checksum);
+
+// Bisect checksums, finds the first tick two logs disagree on by binary search over their
+// chains and prints the fields that differ there. Returns zero when the logs agree.
+
+int bisect_checksums(const std::string& a, const std::string& b, std::FILE* out);
+
+#endif
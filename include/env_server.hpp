@@ -0,0 +1,54 @@
+#ifndef ENV_SERVER_HPP
+#define ENV_SERVER_HPP
+
+// Includes
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Env config
+
+struct EnvConfig {
+   std::string name = "/block_placer";
+   int count = 64, threads = 0;
+   unsigned int seed = 1;
+};
+
+// Shared memory layout, a header followed by arrays with one entry per environment. Offsets
+// are from the start of the region and 64 byte aligned, and magic is set once the region is
+// ready.
+//
+//    boards   uint8[count][height][width]  1 where a tile is filled, borders included
+//    states   EnvState[count]
+//    actions  uint8[count]                 held keys, the bits of Input::Key
+//    rewards  float[count]                 score gained by the last step
+//    dones    uint8[count]                 1 when the last step lost, the env then restarts
+//
+// The trainer writes the actions, increments requested and wakes it with a futex. The server
+// steps every environment one tick, sets completed to requested and wakes it. Setting stop
+// ends the server.
+
+// Env state, the pieces are 4x4 masks with bit y * 4 + x set for a filled tile and x, y the
+// position of the current piece on the board
+
+struct EnvState {
+   std::uint16_t current, next;
+   std::int8_t x, y;
+   std::uint8_t rotation, level;
+   std::int32_t score;
+};
+
+struct EnvHeader {
+   static constexpr std::uint32_t expected_magic = 0x42504C31;
+
+   std::uint32_t magic, count, width, height;
+   std::uint64_t size, boards, states, actions, rewards, dones;
+   std::atomic<std::uint32_t> requested, completed, stop;
+};
+
+// Run env server, creates the shared memory region and steps it until the trainer stops it
+
+int run_env_server(const EnvConfig& config);
+
+#endif
@@ -3,6 +3,7 @@
 
 // Includes
 
+#include "options.hpp"
 #include "state.hpp"
 
 // Game
@@ -11,7 +12,7 @@ class Game {
    States states;
 
 public:
-   Game();
+   Game(const Options& options);
    ~Game();
 
    void run();
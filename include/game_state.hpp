@@ -5,77 +5,71 @@
 
 #include "util/button.hpp"
 #include "util/slider.hpp"
+#include "board_renderer.hpp"
+#include "bot.hpp"
+#include "checksum.hpp"
+#include "history.hpp"
+#include "rollback.hpp"
+#include "savestate.hpp"
+#include "solver.hpp"
+#include "simulation.hpp"
+#include "spectator.hpp"
 #include "state.hpp"
-#include <unordered_map>
+#include <memory>
+#include <optional>
 #include <vector>
 
 // Structs
 
-// Tetromino
-
-struct Tetromino {
-   std::vector<std::vector<bool>> tiles;
-   int rotation = 0;
-};
-
-// Tile
-
-struct Tile {
-   enum Type { off, on, border };
-
-   Type type = Type::off;
-   Color color;
-};
-
 // Keybinds
 
 struct Keys {
    int rotate, left, right, down, send;
 };
 
-// Player
-
-struct Player {
-   std::vector<Tetromino> bag;
-   Tetromino tetromino, next_tetromino;
-   Keys key;
-   Color color, next_color;
-   Vector2 pos, starting_pos;
-   int preview_y = 0, id = 0;
-   bool soft_drop = false, hard_drop = false;
-   float down_timer = 0;
-};
-
 // Game state
 
 class GameState : public State {
    // Enums
 
-   enum class Path { left, right, down, current };
    enum class Phase { fading_in, fading_out, playing, paused, lost };
 
    // Variables
 
-   std::unordered_map<int, float> keys_down;
-   std::vector<std::vector<std::vector<Tile>>> tiles;
-   std::vector<std::vector<std::vector<Tile>>> next_tiles;
-   std::vector<Player> players;
-   
+   Simulation sim;
+   std::unique_ptr<Rollback> net;
+   std::unique_ptr<Spectator> viewer;
+   std::vector<std::unique_ptr<Bot>> bots;
+   std::optional<BotLevel> cpu_level;
+   std::vector<unsigned char> quick_save;
+   std::unique_ptr<ThreadPool> solver_pool;
+   std::optional<Placement> hint;
+   Checksummer checksummer;
+   std::uint64_t checked_ticks = 0;
+   float tick_accumulator = 0;
+
    Texture tile_tx;
+   BoardRenderer board_renderer;
    Vector2 grid, tile;
    Color screen_tint, lost_screen_tint;
    Button continue_button, restart_button, menu_button;
    Slider music_slider, sfx_slider;
 
-   int game_width = 0, game_height = 0, score = 0, hi_score = 0, total_clears = 0, combo_count = -1, difficult_count = 0, level = 0, player_count = 0;
-   float down_after = 1, fade_in_timer = 0, fade_out_timer = 0, lost_timer = 0;
-   bool restart = false, lost = false, versus = false, left_win = false;
+   int game_width = 0, game_height = 0, preview_columns = 1, hi_score = 0, player_count = 0, hint_pieces = -1, hint_length = 0;
+   float tile_scale = 0;
+   float fade_in_timer = 0, fade_out_timer = 0, lost_timer = 0, autosave_timer = 0;
+   bool restart = false, lost = false, versus = false, show_hint = false;
    Phase phase = Phase::fading_in;
-   
+
 public:
    // Constructors
 
+   GameState(const Simulation& simulation);
    GameState(const Vector2& grid_size, int player_count, bool versus);
+   GameState(const Vector2& grid_size, const NetConfig& config);
+   GameState(const Vector2& grid_size, const BotLevel& cpu_level);
+   GameState(const Simulation& simulation, std::unique_ptr<Spectator> spectator);
+   GameState(const Savestate& savestate);
    ~GameState();
 
    // Update
@@ -90,28 +84,25 @@ public:
    // Render
 
    void render() override;
+   void draw_board(int slot, const Board& board, const Vector2& position);
+   bool idle() const override;
 
    // Change states
 
    void change_state(States& states) override;
+   void suspend() override;
 
    // Utility
 
-   void draw_tetromino(const Player& player);
-   void draw_next_tetromino(const Player& player);
-
-   bool can_move(const Tetromino& tetromino, const Vector2& pos, Path type, int id);
-   void rotate(Player& player);
-
-   void clear_cleared_rows(const Player& player);
-   void add_drop_score(const Player& player, bool hard);
-   void add_score(int plus);
-   Tetromino get_random_tetromino(Player& player);
-   Color get_random_color();
-   bool is_versus_block(const Color& color);
-
-   void update_key(int key);
-   bool key_down(int key);
+   void assign_controllers();
+   void step_simulation(bool accept_input);
+   void update_savestates();
+   void update_hint();
+   Savestate make_savestate() const;
+   MatchRecord make_match_record() const;
+   bool local() const;
+   Input read_input(const Keys& key);
+   Input read_gamepad(int gamepad);
 };
 
 #endif
@@ -0,0 +1,60 @@
+#ifndef GRID_STATE_HPP
+#define GRID_STATE_HPP
+
+// Includes
+
+#include "util/thread_pool.hpp"
+#include "bot.hpp"
+#include "simulation.hpp"
+#include "state.hpp"
+#include <optional>
+#include <random>
+#include <vector>
+
+// Grid state, watches many bot games at once. Every board is written as one pixel per tile
+// into a single image that is uploaded once per frame, and a clicked board is shown at full
+// detail with the tile sprite.
+
+class GridState : public State {
+   // Bot game, one watched board
+
+   struct BotGame {
+      Simulation sim;
+      BotWeights weights;
+      TranspositionTable table;
+   };
+
+   std::vector<BotGame> games;
+   ThreadPool pool;
+   std::mt19937 rng;
+
+   Texture texture, tile_tx;
+   std::vector<Color> pixels;
+   Vector2 grid, tile;
+   Rectangle view;
+
+   int columns = 0, rows = 0;
+   float place_timer = 0;
+   std::optional<int> zoomed;
+
+public:
+   GridState(int count, unsigned int seed, int threads = 0);
+   ~GridState();
+
+   // Update
+
+   void update() override;
+   void place_pieces();
+
+   // Render
+
+   void render() override;
+   void render_grid();
+   void render_zoomed(const Simulation& sim);
+
+   // Change states
+
+   void change_state(States& states) override;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef HISTORY_HPP
+#define HISTORY_HPP
+
+// Includes
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Match record, one finished game. Records have a fixed size, so the log is read at any
+// record without an offset table.
+
+struct MatchRecord {
+   enum Mode : std::uint8_t { single, co_op, versus, cpu, online, dig, modes };
+
+   std::int64_t finished = 0; // Unix time
+   std::uint32_t seed = 0;
+   std::int32_t score = 0, lines = 0;
+   float duration = 0, pieces_per_second = 0;
+   std::uint8_t mode = single, players = 1, grid_width = 0, grid_height = 0;
+   std::int16_t level = 0;
+};
+
+// Mode averages, over every game of a mode
+
+struct ModeAverages {
+   std::int64_t games = 0;
+   double score = 0, level = 0, lines = 0, duration = 0, pieces_per_second = 0;
+};
+
+// Day totals, the games of a mode finished on one UTC day
+
+struct DayTotals {
+   std::int32_t day = 0; // Days since the Unix epoch
+   std::int32_t games = 0;
+   double score = 0;
+};
+
+// History functions. Finished games are appended to a log, and an index beside it keeps the
+// best scores, the sums behind the averages and per-day totals of each mode, so queries never
+// read the whole log. A background thread folds new records into the index file now and then,
+// and opening catches up on any records the index file is missing.
+
+bool open_history(const std::string& file);
+void close_history();
+void record_match(const MatchRecord& record);
+
+std::vector<MatchRecord> top_matches(MatchRecord::Mode mode, int count);
+ModeAverages mode_averages(MatchRecord::Mode mode);
+std::vector<DayTotals> daily_trend(MatchRecord::Mode mode, int days);
+
+// Print history, the averages, best games and recent days of every mode played
+
+int print_history(const std::string& file, std::FILE* out);
+
+// Constants
+
+constexpr const char* history_file = "history.data";
+
+#endif
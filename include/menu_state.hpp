@@ -11,9 +11,9 @@
 class MenuState : public State {
    enum class Phase { fading_in, idle, fading_out };
    
-   Button play_button, co_op_button, versus_button, quit_button;
+   Button play_button, co_op_button, versus_button, cpu_button, cpu_level_button, dig_button, royale_button, quit_button;
    Color screen_tint {0, 0, 0, 255};
-   bool quit_for_good = false, play_co_op = false, play_versus = false;
+   bool quit_for_good = false, play_co_op = false, play_versus = false, play_cpu = false, play_dig = false, play_royale = false;
    float fade_in_timer = 0, fade_out_timer = 0, initial_volume = 0.f;
    Phase phase = Phase::fading_in;
    
@@ -31,6 +31,7 @@ public:
    // Render
    
    void render() override;
+   bool idle() const override;
 
    // Change states
 
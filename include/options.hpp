@@ -0,0 +1,41 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+// Includes
+
+#include "capture.hpp"
+#include "env_server.hpp"
+#include "rollback.hpp"
+#include "render_bench.hpp"
+#include "royale.hpp"
+#include "server.hpp"
+#include "tournament.hpp"
+#include "tuner.hpp"
+#include <optional>
+#include <string>
+
+// Options, parsed from the command line
+
+struct Options {
+   std::optional<NetConfig> net;
+   std::optional<int> broadcast_port;
+   std::optional<std::pair<std::string, int>> spectate;
+   std::optional<std::string> telemetry_file, telemetry_export, checksum_file;
+   std::optional<std::pair<std::string, std::string>> desync;
+   std::string savestate_file;
+   std::optional<ServerConfig> server;
+   std::optional<TunerConfig> tuner;
+   std::optional<TournamentConfig> tournament;
+   std::optional<EnvConfig> env;
+   std::optional<RenderBenchConfig> render_bench;
+   std::optional<CaptureConfig> capture;
+   std::optional<RoyaleConfig> royale;
+   std::optional<unsigned int> seed;
+   std::optional<int> threads, low_latency_fps;
+   int perft_depth = 0, solve_pieces = 0, watch_count = 0, co_op_players = 0;
+   bool play_online = false, measure_latency = false, show_history = false, dig = false;
+};
+
+Options parse_options(int argc, char** argv);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef PERFT_HPP
+#define PERFT_HPP
+
+// Includes
+
+#include <vector>
+
+// Run perft, counts the placements reachable N pieces deep on an empty single player board
+// for every seed and prints the counts and nodes per second for each depth
+
+int run_perft(int depth, const std::vector<unsigned int>& seeds);
+
+#endif
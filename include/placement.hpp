@@ -0,0 +1,39 @@
+#ifndef PLACEMENT_HPP
+#define PLACEMENT_HPP
+
+// Includes
+
+#include "simulation.hpp"
+#include <vector>
+
+// Structs
+
+// Placement, a final resting spot of a tetromino and the key presses that reach it from the
+// starting position. The presses end with a hard drop.
+
+struct Placement {
+   Tetromino tetromino;
+   Vector2 pos;
+   std::vector<Input::Key> inputs;
+};
+
+// Placement board, one byte of occupancy per cell with the border included
+
+struct PlacementBoard {
+   std::vector<unsigned char> cells;
+   int width = 0, height = 0;
+
+   PlacementBoard() = default;
+   PlacementBoard(const Board& board);
+
+   bool occupied(int x, int y) const;
+   bool fits(const Tetromino& tetromino, int px, int py) const;
+   int lock(const Tetromino& tetromino, const Vector2& pos);
+   bool empty() const;
+};
+
+// Placement functions
+
+std::vector<Placement> enumerate_placements(const PlacementBoard& board, const Tetromino& tetromino, const Vector2& pos, bool with_inputs = true);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef RENDER_BENCH_HPP
+#define RENDER_BENCH_HPP
+
+// Includes
+
+#include <raylib.h>
+
+// Render bench config
+
+struct RenderBenchConfig {
+   int frames = 600;
+   Vector2 grid {12, 22};
+   int co_op_players = 4;
+};
+
+// Run render bench, draws single, co-op and versus games with full boards, pieces in flight
+// with their ghosts and the pause screen on top, through the game's own render, and prints
+// frame time percentiles for each
+
+int run_render_bench(const RenderBenchConfig& config);
+
+#endif
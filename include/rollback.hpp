@@ -0,0 +1,53 @@
+#ifndef ROLLBACK_HPP
+#define ROLLBACK_HPP
+
+// Includes
+
+#include "util/socket.hpp"
+#include "checksum.hpp"
+#include "simulation.hpp"
+#include <string>
+#include <vector>
+
+// Net config
+
+struct NetConfig {
+   std::string peer_host = "127.0.0.1";
+   int port = 7000, peer_port = 7001, side = 0;
+   unsigned int seed = 0;
+   float latency = 0.f, loss = 0.f;
+};
+
+// Rollback session, runs a versus simulation with one local and one remote player. Remote
+// inputs are predicted by repeating the last confirmed one; when a late input disagrees with
+// the prediction the simulation is restored from the snapshot of that tick and re-simulated.
+
+class Rollback {
+   UdpSocket socket;
+   std::vector<Simulation> snapshots;
+   std::vector<Input> local_inputs, remote_inputs;
+   std::vector<bool> remote_received;
+   Checksummer checksummer;
+   unsigned int session = 0;
+   float accumulator = 0;
+   int local_id = 0, remote_id = 1, tick = 0, remote_tick = -1, acked_tick = -1, rollback_tick = -1, checked_tick = -1;
+
+   void receive();
+   void send();
+   void resimulate(Simulation& sim);
+   void log_confirmed(const Simulation& sim);
+   Input remote_input(int at);
+   std::vector<Input> inputs_at(int at);
+
+public:
+   bool connected = false;
+   int rollbacks = 0, stalls = 0;
+
+   bool open(const NetConfig& config);
+   void advance(Simulation& sim, const Input& local, float dt);
+
+   bool confirmed() const;
+   int get_local_id() const;
+};
+
+#endif
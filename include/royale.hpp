@@ -0,0 +1,70 @@
+#ifndef ROYALE_HPP
+#define ROYALE_HPP
+
+// Includes
+
+#include "util/thread_pool.hpp"
+#include "bot.hpp"
+#include "simulation.hpp"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Royale config
+
+struct RoyaleConfig {
+   int boards = 64, humans = 1, threads = 0;
+   unsigned int seed = 0;
+};
+
+// Royale, many boards sending garbage to each other until one is left standing. Humans play
+// the first boards and bots the rest.
+//
+// Every board is its own simulation and steps on the thread pool without touching any other.
+// Lines a board sends wait in its outbox, and between ticks they are passed in board order to
+// the inbox of its target, which takes them as queued garbage at the start of its next tick.
+// A board that loses is placed by how many were still standing. Past the margin time every
+// standing board also gets a line now and then, more often as time goes on, so a royale
+// between boards that rarely send still ends.
+
+class Royale {
+public:
+   // Contender, one board and whoever plays it
+
+   struct Contender {
+      Simulation sim;
+      BotWeights weights;
+      TranspositionTable table;
+      std::vector<std::uint64_t> inbox;
+      float place_interval = 0, place_timer = 0;
+      int target = -1, attacker = -1, place = 0, knockouts = 0, sent = 0;
+      bool human = false;
+   };
+
+   std::vector<Contender> contenders;
+   ThreadPool pool;
+   std::mt19937 rng;
+   int alive = 0;
+   std::uint64_t ticks = 0;
+   float time = 0, margin_timer = 0;
+
+   Royale(const Vector2& grid, const RoyaleConfig& config);
+
+   // Step, advances every standing board by dt with one input per human, then exchanges the
+   // lines sent
+
+   void step(const std::vector<Input>& inputs, float dt);
+   bool over() const;
+
+private:
+   void update_contender(Contender& contender, const Input& input, float dt);
+   void exchange();
+   void add_margin_lines(float dt);
+   int pick_target(int sender);
+};
+
+// Constants
+
+constexpr int max_royale_boards = 64;
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef ROYALE_STATE_HPP
+#define ROYALE_STATE_HPP
+
+// Includes
+
+#include "board_renderer.hpp"
+#include "royale.hpp"
+#include "state.hpp"
+#include <vector>
+
+// Royale state, plays a royale at a fixed tick. Human boards are drawn at full size on the
+// left, and every board is written as one pixel per tile into a single image that is scaled
+// into the overview beside them.
+
+class RoyaleState : public State {
+   Royale royale;
+   int humans = 0;
+
+   Texture texture, tile_tx;
+   BoardRenderer board_renderer;
+   std::vector<Color> pixels;
+   Vector2 grid, tile;
+   Rectangle view;
+
+   int columns = 0, rows = 0;
+   float tile_scale = 0, accumulator = 0, tick_ms = 0;
+
+public:
+   RoyaleState(const RoyaleConfig& config);
+   ~RoyaleState();
+
+   // Update
+
+   void update() override;
+
+   // Render
+
+   void render() override;
+   void render_overview();
+   void render_human(int index, const Vector2& position);
+
+   // Change states
+
+   void change_state(States& states) override;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef SAVESTATE_HPP
+#define SAVESTATE_HPP
+
+// Includes
+
+#include "util/bytes.hpp"
+#include "bot.hpp"
+#include "simulation.hpp"
+#include <optional>
+#include <string>
+#include <vector>
+
+// Savestate, everything needed to carry on a local game exactly where it was left
+
+struct Savestate {
+   enum class Phase : std::uint8_t { playing, paused };
+
+   Simulation sim;
+   Phase phase = Phase::playing;
+   std::optional<BotLevel> cpu_level;
+};
+
+// Encoding functions. The blob starts with a magic and a version, and a blob of another
+// version doesn't decode.
+
+std::vector<unsigned char> encode_savestate(const Savestate& state);
+std::optional<Savestate> decode_savestate(const std::vector<unsigned char>& data);
+
+// File functions, writing replaces the file in one rename so a crash never leaves half a
+// savestate
+
+bool write_savestate(const std::string& file, const Savestate& state);
+std::optional<Savestate> read_savestate(const std::string& file);
+
+// Constants
+
+constexpr const char* suspend_file = "suspend.data";
+
+#endif
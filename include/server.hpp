@@ -0,0 +1,18 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+// Server config
+
+struct ServerConfig {
+   int port = 7700, threads = 0, load = 0;
+   float report_interval = 5.f, duration = 0.f;
+};
+
+// Run server, hosts versus matches without a window until the duration runs out (or forever
+// when it is zero). Clients are paired in the order they connect, each sends one byte of held
+// keys whenever its input changes and receives broadcast frames of its match. A load of N
+// adds N matches driven by random inputs to measure capacity.
+
+int run_server(const ServerConfig& config);
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+
+// Includes
+
+#include "board.hpp"
+#include "telemetry.hpp"
+#include <raylib.h>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Structs
+
+// Tetromino
+
+struct Tetromino {
+   std::vector<std::vector<bool>> tiles;
+   int rotation = 0;
+};
+
+// Input, one bit per held key. Presses are derived from the previous tick's input so
+// that a predicted input (the last one repeated) never fires the same press twice.
+
+struct Input {
+   enum Key : unsigned char { rotate = 1, left = 2, right = 4, down = 8, send = 16 };
+
+   unsigned char held = 0;
+};
+
+// Player
+
+struct Player {
+   std::vector<Tetromino> bag;
+   Tetromino tetromino, next_tetromino;
+   unsigned char color = Tile::off, next_color = Tile::off;
+   Vector2 pos, starting_pos;
+   Input previous_input;
+   int preview_y = 0, id = 0, board = 0, pieces = 0;
+   bool soft_drop = false, hard_drop = false, waiting = false;
+   float down_timer = 0, left_timer = 0, right_timer = 0, soft_drop_timer = 0;
+};
+
+// Simulation, the rules of the game without any window, input device or audio device.
+// Copying a simulation is a complete snapshot of the game.
+
+class Simulation {
+public:
+   // Enums
+
+   enum class Path { left, right, down, current };
+
+   // Variables
+
+   std::vector<Board> tiles;
+   std::vector<Board> next_tiles;
+   std::vector<std::vector<std::uint64_t>> garbage; // Pending lines per board, one bit per hole
+   std::vector<std::vector<unsigned char>> active; // Pieces in flight per shared board, owner id plus one per cell
+   std::vector<Player> players;
+   std::vector<std::string> sounds;
+   std::vector<TelemetryEvent> events; // Only filled while telemetry is set
+   std::mt19937 rng;
+
+   Vector2 grid;
+   int score = 0, total_clears = 0, combo_count = -1, difficult_count = 0, level = 0, player_count = 0;
+   unsigned int seed = 0;
+   float down_after = 1, time = 0;
+   bool versus = false, lost = false, left_win = false, telemetry = false;
+
+   // Dig, garbage rows rise from an endless column made from the seed, and dug counts the
+   // garbage rows cleared
+
+   bool dig = false;
+   std::uint64_t dig_rows = 0;
+   int dig_hole = 0, dug = 0;
+   float rise_timer = 0;
+
+   // Royale, the board is one of many. Lines it sends collect in the outbox for the royale to
+   // deliver between ticks, and lines sent to it arrive in garbage[0].
+
+   bool royale = false;
+   std::vector<std::uint64_t> outbox;
+
+   // Constructors
+
+   Simulation() = default;
+   Simulation(const Vector2& grid, int player_count, bool versus, unsigned int seed);
+
+   // Update
+
+   void step(const std::vector<Input>& inputs, float dt);
+
+   // Utility
+
+   void draw_tetromino(const Player& player);
+   void draw_next_tetromino(const Player& player);
+
+   bool can_move(const Tetromino& tetromino, const Vector2& pos, Path type, const Player& player, bool pieces = true);
+   void index_piece(const Player& player, const Tetromino& tetromino, const Vector2& pos, unsigned char value);
+   void lift_pieces(const Player& locked);
+   bool spawn(Player& player);
+   void rotate(Player& player);
+
+   void clear_cleared_rows(const Player& player);
+   void insert_garbage(int id);
+   void start_dig();
+   std::uint64_t next_dig_row();
+   void record(const Player& player, TelemetryEvent::Type type, int a = 0, int b = 0, int c = 0);
+   void add_drop_score(const Player& player, bool hard);
+   void add_score(int plus);
+   Tetromino get_random_tetromino(Player& player);
+   unsigned char get_random_color();
+   bool is_versus_block(unsigned char tile);
+
+   bool key_down(const Input& input, const Input& previous, Input::Key key, float& timer, float dt);
+};
+
+// Tile functions
+
+Color tile_color(unsigned char tile);
+
+// Rotation functions
+
+Tetromino rotated(const Tetromino& tetromino);
+const std::vector<Vector2>& wall_kicks(const Tetromino& tetromino);
+
+// Constants
+
+constexpr float tick_time = 1.f / 60.f;
+
+#endif
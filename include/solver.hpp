@@ -0,0 +1,41 @@
+#ifndef SOLVER_HPP
+#define SOLVER_HPP
+
+// Includes
+
+#include "util/thread_pool.hpp"
+#include "placement.hpp"
+#include <string>
+#include <vector>
+
+// Structs
+
+// Perfect clear, the placements that empty the board in piece order. A search that ran out
+// of time, or of known pieces, without finding one isn't complete, so it says nothing about
+// whether one exists.
+
+struct PerfectClear {
+   std::vector<Placement> placements;
+   bool complete = false, out_of_pieces = false;
+   long long nodes = 0;
+};
+
+// Solver functions
+
+// Upcoming pieces, the current and next piece followed by what is left of the bag. Pieces
+// past the bag aren't drawn yet, so they can't be known.
+
+std::vector<Tetromino> upcoming_pieces(const Player& player);
+
+// Find perfect clear, tries the fewest pieces first and searches every placement of the first
+// piece as its own task on the pool
+
+PerfectClear find_perfect_clear(const PlacementBoard& board, const std::vector<Tetromino>& pieces, const Vector2& spawn, int max_pieces,
+   float time_budget, ThreadPool& pool);
+
+// Run solver, looks for a perfect clear in a saved game, or on an empty board for every
+// seed, and prints the sequence
+
+int run_solver(int max_pieces, const std::string& savestate_file, const std::vector<unsigned int>& seeds);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef SPECTATOR_HPP
+#define SPECTATOR_HPP
+
+// Includes
+
+#include "simulation.hpp"
+#include <string>
+#include <vector>
+
+// Spectator, a client of a broadcast or of a match server. Received frames are applied to a
+// simulation that is only ever rendered, never stepped. A player also sends its held keys.
+
+class Spectator {
+   std::vector<unsigned char> buffer;
+   Input sent_input;
+   int fd = -1;
+
+public:
+   bool connected = false, player = false;
+
+   Spectator() = default;
+   Spectator(const Spectator&) = delete;
+   Spectator& operator=(const Spectator&) = delete;
+   ~Spectator();
+
+   bool connect(const std::string& host, int port, Simulation& sim);
+   void receive(Simulation& sim);
+   void send_input(const Input& input);
+};
+
+#endif
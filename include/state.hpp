@@ -21,6 +21,12 @@ public:
    virtual void update() = 0;
    virtual void render() = 0;
    virtual void change_state(States& states) = 0;
+
+   // Idle, true while nothing on screen can change without input
+   virtual bool idle() const { return false; }
+
+   // Suspend, called when the window closes with this state in front
+   virtual void suspend() {}
 };
 
 #endif
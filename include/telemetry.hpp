@@ -0,0 +1,42 @@
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+
+// Includes
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Telemetry event, one fixed size record per gameplay event. What a, b and c hold depends on
+// the type:
+//   spawn:   pieces placed so far, color
+//   rotate:  new rotation, wall kick index
+//   lock:    rotation, hard drop
+//   clear:   lines, combo count, difficult count
+//   garbage: lines sent, lines cancelled
+//   level:   new level
+//   dropped: events lost to a full ring since the last dropped event
+
+struct TelemetryEvent {
+   enum Type : std::uint8_t { spawn, rotate, lock, clear, garbage, level, dropped };
+
+   std::uint64_t time = 0; // Microseconds since recording started
+   float frame_time = 0;
+   std::uint8_t type = spawn, player = 0;
+   std::int8_t x = 0, y = 0;
+   std::int16_t a = 0, b = 0, c = 0;
+};
+
+// Telemetry functions. Each thread records into its own ring without locks, and a background
+// thread drains the rings into the file. Events are dropped, and counted, when a ring is full.
+
+void start_telemetry(const std::string& file);
+void stop_telemetry();
+bool is_recording_telemetry();
+void record_telemetry(TelemetryEvent event);
+
+// Export, writes a telemetry file as CSV with one line per event
+
+bool export_telemetry_csv(const std::string& file, std::FILE* out);
+
+#endif
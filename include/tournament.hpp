@@ -0,0 +1,25 @@
+#ifndef TOURNAMENT_HPP
+#define TOURNAMENT_HPP
+
+// Includes
+
+#include <string>
+
+// Tournament config
+
+struct TournamentConfig {
+   std::string entrants;
+   int games = 8, max_pieces = 1000, threads = 0;
+   unsigned int seed = 1;
+};
+
+// Run tournament, plays every pair of bot entrants against each other in versus on all cores.
+// Each seeded game is played twice with the sides swapped, and a game still going after the
+// piece limit is a draw. Prints Elo ratings with 95% confidence intervals from the results.
+//
+// Entrants are read one per line as a name followed by the five bot weights and optionally a
+// node budget and beam width. Without a file a few built in strategies play.
+
+int run_tournament(const TournamentConfig& config);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef TUNER_HPP
+#define TUNER_HPP
+
+// Includes
+
+#include <string>
+
+// Tuner config
+
+struct TunerConfig {
+   std::string checkpoint = "tuner.txt";
+   int generations = 50, population = 48, games = 8, max_pieces = 500, threads = 0;
+   unsigned int seed = 1;
+};
+
+// Run tuner, improves the bot weights with the cross-entropy method. Every generation samples
+// a population of weights around the current mean, plays each of them through the same seeded
+// games on all cores and moves the mean towards the best quarter. The state is saved to the
+// checkpoint after every generation and picked up from it on the next run.
+
+int run_tuner(const TunerConfig& config);
+
+#endif
@@ -25,4 +25,13 @@ float get_music_volume();
 void set_music_volume(float volume);
 void update_music();
 
+// Latency functions, measure how long a key press takes to become a sound. The press is
+// stamped when the frame's input is read, the sound when play_audio is called and again when
+// the mixer next hands a buffer to the device. The device's own buffering after that can't
+// be seen from here, so the report is a lower bound.
+
+void start_latency_measurement();
+void stop_latency_measurement();
+void note_input(bool pressed);
+
 #endif
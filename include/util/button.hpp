@@ -17,6 +17,7 @@ public:
 
    void update();
    void draw();
+   bool resting() const;
 };
 
 #endif
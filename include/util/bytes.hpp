@@ -0,0 +1,62 @@
+#ifndef UTIL_BYTES_HPP
+#define UTIL_BYTES_HPP
+
+// Includes
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Byte writer, appends trivially copyable values in host byte order
+
+struct ByteWriter {
+   std::vector<unsigned char> data;
+
+   template<typename T>
+   void write(const T& value) {
+      static_assert(std::is_trivially_copyable_v<T>);
+      auto bytes = reinterpret_cast<const unsigned char*>(&value);
+      data.insert(data.end(), bytes, bytes + sizeof(T));
+   }
+};
+
+// Byte reader, reads values written by ByteWriter. Reading past the end sets failed and
+// returns a default value instead.
+
+struct ByteReader {
+   const unsigned char* data = nullptr;
+   size_t size = 0, offset = 0;
+   bool failed = false;
+
+   ByteReader(const std::vector<unsigned char>& bytes)
+      : data(bytes.data()), size(bytes.size()) {}
+   ByteReader(const unsigned char* data, size_t size)
+      : data(data), size(size) {}
+
+   template<typename T>
+   T read() {
+      static_assert(std::is_trivially_copyable_v<T>);
+      T value {};
+      if (offset + sizeof(T) > size) {
+         failed = true;
+         offset = size;
+         return value;
+      }
+      std::memcpy(&value, data + offset, sizeof(T));
+      offset += sizeof(T);
+      return value;
+   }
+};
+
+// Mix, the splitmix64 finalizer. Spreads every input bit over the output, for hashing values
+// and deriving seeds.
+
+inline std::uint64_t mix(std::uint64_t x) {
+   x += 0x9E3779B97F4A7C15ull;
+   x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+   x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+   return x ^ (x >> 31);
+}
+
+#endif
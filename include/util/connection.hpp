@@ -0,0 +1,24 @@
+#ifndef UTIL_CONNECTION_HPP
+#define UTIL_CONNECTION_HPP
+
+// Includes
+
+#include <vector>
+
+// Connection, a non-blocking stream socket with its unsent bytes. Messages are framed with
+// a 4 byte length so a reader can split the stream back into frames.
+
+struct Connection {
+   std::vector<unsigned char> pending;
+   int fd = -1;
+   bool needs_keyframe = true;
+};
+
+// Connection functions
+
+int listen_on(int port);
+void queue_message(Connection& connection, const std::vector<unsigned char>& payload);
+bool flush_connection(Connection& connection);
+void close_connection(Connection& connection);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef UTIL_SOCKET_HPP
+#define UTIL_SOCKET_HPP
+
+// Includes
+
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+// UDP socket class, non-blocking and bound to one peer. Datagrams from any other address are
+// dropped. Latency and loss can be injected on the sending side to test netplay on loopback.
+
+class UdpSocket {
+   struct Delayed {
+      double send_time;
+      std::vector<unsigned char> data;
+   };
+
+   std::deque<Delayed> outgoing;
+   std::mt19937 loss_rng {std::random_device{}()};
+   int fd = -1, peer_port = 0;
+   unsigned int peer_address = 0; // Network byte order
+
+public:
+   float latency = 0.f, loss = 0.f;
+
+   UdpSocket() = default;
+   UdpSocket(const UdpSocket&) = delete;
+   UdpSocket& operator=(const UdpSocket&) = delete;
+   ~UdpSocket();
+
+   bool open(int port, const std::string& host, int host_port);
+   void close();
+
+   void send(const std::vector<unsigned char>& data);
+   bool receive(std::vector<unsigned char>& data);
+   void flush();
+};
+
+// Resolve host, a name or dotted address to an IPv4 address in network byte order
+
+bool resolve_host(const std::string& host, unsigned int& address);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef UTIL_THREAD_POOL_HPP
+#define UTIL_THREAD_POOL_HPP
+
+// Includes
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Thread pool class, one task queue per worker. A worker takes its newest task first and
+// steals the oldest task of another worker when its own queue is empty, so uneven tasks
+// spread over every core.
+
+class ThreadPool {
+   struct Queue {
+      std::mutex mutex;
+      std::deque<std::function<void()>> tasks;
+   };
+
+   std::vector<std::thread> workers;
+   std::vector<std::unique_ptr<Queue>> queues;
+   std::mutex mutex;
+   std::condition_variable task_added, tasks_done;
+   std::atomic<int> queued = 0, pending = 0;
+   int next_queue = 0;
+   bool running = true;
+
+   bool pop(int index, std::function<void()>& task);
+   void run(int index);
+
+public:
+   ThreadPool(int thread_count = 0);
+   ThreadPool(const ThreadPool&) = delete;
+   ThreadPool& operator=(const ThreadPool&) = delete;
+   ~ThreadPool();
+
+   void submit(std::function<void()> task);
+   void wait();
+   int size() const;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#include "board.hpp"
+
+// Includes
+
+#include <algorithm>
+#include <atomic>
+
+// Constructor, an empty board with a border around it
+
+Board::Board(int width, int height)
+   : cells(std::make_shared<std::vector<unsigned char>>(width * height, Tile::off)), width(width), height(height) {
+   for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+         if (y == 0 or y == height - 1 or x == 0 or x == width - 1) {
+            (*cells)[y * width + x] = Tile::border;
+         }
+      }
+   }
+}
+
+// Unshare, copies the tiles before the first write while a snapshot still holds them
+
+void Board::unshare() {
+   if (cells.use_count() > 1) {
+      cells = std::make_shared<std::vector<unsigned char>>(*cells);
+   } else {
+      std::atomic_thread_fence(std::memory_order_acquire);
+   }
+}
+
+// Rise, moves the rows between the borders up by one, dropping the top one, and returns the
+// new bottom row empty between its borders. Turning the ring moves the rows, the old top row
+// becomes the top border and the old bottom border the new bottom row.
+
+unsigned char* Board::rise() {
+   unshare();
+   first = slot(1);
+   std::fill_n(slot_row(0), width, Tile::border);
+
+   unsigned char* bottom = slot_row(height - 2);
+   std::fill_n(bottom + 1, width - 2, Tile::off);
+   return bottom;
+}
+
+// Remove row, the rows above move down by one and an empty row comes in at the top. Whichever
+// side of the row has fewer rows is moved, the lower side by turning the ring back first.
+
+void Board::remove_row(int y) {
+   unshare();
+   if (y - 1 <= height - 2 - y) {
+      for (int i = y; i > 1; --i) {
+         std::copy_n(slot_row(i - 1), width, slot_row(i));
+      }
+   } else {
+      first = slot(height - 1);
+      for (int i = y + 1; i < height - 1; ++i) {
+         std::copy_n(slot_row(i + 1), width, slot_row(i));
+      }
+      std::fill_n(slot_row(height - 1), width, Tile::border);
+      std::fill_n(slot_row(1), width, Tile::border);
+   }
+   std::fill_n(slot_row(1) + 1, width - 2, Tile::off);
+}
+
+bool Board::shares_tiles(const Board& other) const {
+   return cells == other.cells;
+}
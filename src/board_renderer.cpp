@@ -0,0 +1,88 @@
+#include "board_renderer.hpp"
+
+// Includes
+
+#include "simulation.hpp"
+
+// Constants
+
+namespace {
+   constexpr const char* board_shader = "assets/shaders/board.fs";
+   constexpr int palette_size = 256;
+}
+
+// Constructor
+
+BoardRenderer::BoardRenderer() {
+   // A missing file would load the default shader, which looks valid
+
+   if (not FileExists(board_shader)) {
+      return;
+   }
+   shader = LoadShader(nullptr, board_shader);
+   if (not IsShaderValid(shader)) {
+      return;
+   }
+   palette_loc = GetShaderLocation(shader, "palette");
+   sprite_loc = GetShaderLocation(shader, "sprite");
+   grid_loc = GetShaderLocation(shader, "grid");
+   first_loc = GetShaderLocation(shader, "first");
+
+   Image palette = GenImageColor(palette_size, 1, BLANK);
+   for (int i = 1; i < palette_size; ++i) {
+      ImageDrawPixel(&palette, i, 0, tile_color(i));
+   }
+   palette_tx = LoadTextureFromImage(palette);
+   SetTextureFilter(palette_tx, TEXTURE_FILTER_POINT);
+   UnloadImage(palette);
+}
+
+BoardRenderer::~BoardRenderer() {
+   for (const auto& texture : textures) {
+      UnloadTexture(texture);
+   }
+
+   if (IsShaderValid(shader)) {
+      UnloadTexture(palette_tx);
+      UnloadShader(shader);
+   }
+}
+
+bool BoardRenderer::ready() const {
+   return IsShaderValid(shader);
+}
+
+// Draw, the board's texture is reuploaded straight from its tiles only when they no longer
+// share storage with the last upload. The tiles go up in storage order and the shader turns
+// the ring back.
+
+void BoardRenderer::draw(int slot, const Board& board, const Texture& sprite, const Vector2& position, const Vector2& tile) {
+   if (slot >= textures.size()) {
+      textures.resize(slot + 1);
+      uploaded.resize(slot + 1);
+   }
+
+   auto& texture = textures[slot];
+   if (texture.width != board.width or texture.height != board.height) {
+      if (texture.id != 0) {
+         UnloadTexture(texture);
+      }
+      Image image {(void*)board.storage(), board.width, board.height, 1, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE};
+      texture = LoadTextureFromImage(image);
+      SetTextureFilter(texture, TEXTURE_FILTER_POINT);
+      uploaded[slot] = board;
+   } else if (not board.shares_tiles(uploaded[slot])) {
+      UpdateTexture(texture, board.storage());
+      uploaded[slot] = board;
+   }
+
+   Vector2 grid {(float)board.width, (float)board.height};
+   float first = board.first_row();
+   BeginShaderMode(shader);
+      SetShaderValueTexture(shader, palette_loc, palette_tx);
+      SetShaderValueTexture(shader, sprite_loc, sprite);
+      SetShaderValue(shader, grid_loc, &grid, SHADER_UNIFORM_VEC2);
+      SetShaderValue(shader, first_loc, &first, SHADER_UNIFORM_FLOAT);
+      DrawTexturePro(texture, {0, 0, grid.x, grid.y}, {position.x, position.y, grid.x * tile.x, grid.y * tile.y}, {0, 0}, 0.f, WHITE);
+   EndShaderMode();
+}
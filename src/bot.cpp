@@ -0,0 +1,244 @@
+#include "bot.hpp"
+
+// Includes
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Constants
+
+namespace {
+   constexpr size_t max_table_size = 1 << 18;
+   constexpr float topped_out_score = -1e6f;
+   constexpr float weight_spread = .15f;
+
+   struct Node {
+      Placement placement;
+      PlacementBoard board;
+      float score = 0;
+      int lines = 0;
+   };
+}
+
+// Search functions
+
+// Hash board, FNV-1a over the cells
+
+std::uint64_t hash_board(const PlacementBoard& board) {
+   std::uint64_t hash = 0xCBF29CE484222325ull;
+   for (auto cell : board.cells) {
+      hash = (hash ^ cell) * 0x100000001B3ull;
+   }
+   return hash;
+}
+
+// Evaluate board, column heights, holes, bumpiness and well depth weighted into one score.
+// The row loop walks contiguous cells for every column at once so it vectorizes.
+
+float evaluate_board(const PlacementBoard& board, const BotWeights& weights) {
+   thread_local std::vector<int> heights, holes, seen;
+   int width = board.width - 2;
+   heights.assign(width, 0);
+   holes.assign(width, 0);
+   seen.assign(width, 0);
+
+   for (int y = 1; y < board.height - 1; ++y) {
+      const unsigned char* row = board.cells.data() + y * board.width + 1;
+      int height = board.height - 1 - y;
+
+      for (int x = 0; x < width; ++x) {
+         int filled = row[x];
+         heights[x] = std::max(heights[x], filled * height);
+         holes[x] += seen[x] & (filled ^ 1);
+         seen[x] |= filled;
+      }
+   }
+
+   int total_height = 0, total_holes = 0, bumpiness = 0, wells = 0;
+   for (int x = 0; x < width; ++x) {
+      int left = (x == 0 ? board.height : heights[x - 1]);
+      int right = (x == width - 1 ? board.height : heights[x + 1]);
+
+      total_height += heights[x];
+      total_holes += holes[x];
+      wells += std::max(0, std::min(left, right) - heights[x]);
+      if (x + 1 < width) {
+         bumpiness += std::abs(heights[x] - heights[x + 1]);
+      }
+   }
+   return weights.height * total_height + weights.holes * total_holes + weights.bumpiness * bumpiness + weights.wells * wells;
+}
+
+// Find best placement, a beam search over the current and next piece. Boards already scored
+// are looked up in the transposition table. The search stops expanding once it runs out of
+// nodes or time and returns the best placement found so far.
+
+std::optional<Placement> find_best_placement(const PlacementBoard& board, const Tetromino& current, const Tetromino& next, const Vector2& spawn,
+   const BotWeights& weights, const BotLevel& level, TranspositionTable& table) {
+   auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<float>(level.time_budget);
+   int nodes = 0;
+
+   auto score_board = [&](const PlacementBoard& scored) {
+      nodes++;
+      auto hash = hash_board(scored);
+      if (auto it = table.find(hash); it != table.end()) {
+         return it->second;
+      }
+
+      if (table.size() >= max_table_size) {
+         table.clear();
+      }
+      return table[hash] = evaluate_board(scored, weights);
+   };
+
+   std::vector<Node> beam;
+   for (auto& placement : enumerate_placements(board, current, spawn)) {
+      Node node {std::move(placement), board};
+      node.lines = node.board.lock(node.placement.tetromino, node.placement.pos);
+      node.score = score_board(node.board) + weights.lines * node.lines;
+      beam.push_back(std::move(node));
+   }
+
+   if (beam.empty()) {
+      return std::nullopt;
+   }
+   std::sort(beam.begin(), beam.end(), [](const Node& a, const Node& b) { return a.score > b.score; });
+   beam.resize(std::min<int>(beam.size(), level.beam_width));
+
+   int best = 0;
+   float best_score = -std::numeric_limits<float>::infinity();
+
+   for (int i = 0; i < beam.size(); ++i) {
+      if (i > 0 and (nodes >= level.node_budget or std::chrono::steady_clock::now() >= deadline)) {
+         break;
+      }
+      float child_score = topped_out_score;
+
+      for (const auto& placement : enumerate_placements(beam[i].board, next, spawn, false)) {
+         PlacementBoard child = beam[i].board;
+         int lines = child.lock(placement.tetromino, placement.pos);
+         child_score = std::max(child_score, score_board(child) + weights.lines * lines);
+      }
+      float score = weights.lines * beam[i].lines + child_score;
+
+      if (score > best_score) {
+         best_score = score;
+         best = i;
+      }
+   }
+   return beam[best].placement;
+}
+
+// Place best
+
+Input place_best(Simulation& sim, Player& player, const BotWeights& weights, const BotLevel& level, TranspositionTable& table) {
+   auto placement = find_best_placement(PlacementBoard(sim.tiles[player.board]), player.tetromino, player.next_tetromino, player.pos,
+      weights, level, table);
+   if (not placement) {
+      return {};
+   }
+
+   player.tetromino = placement->tetromino;
+   player.pos = placement->pos;
+   player.previous_input = {};
+   return {Input::send};
+}
+
+// Spread weights
+
+BotWeights spread_weights(std::mt19937& rng) {
+   BotWeights weights;
+   for (auto* weight : {&weights.height, &weights.holes, &weights.bumpiness, &weights.wells, &weights.lines}) {
+      *weight += std::normal_distribution<float>(0.f, weight_spread)(rng);
+   }
+   return weights;
+}
+
+// Level functions
+
+// Get bot level, from 0 (easy) to 2 (hard)
+
+BotLevel get_bot_level(int difficulty) {
+   if (difficulty <= 0) {
+      return {.05f, .2f, 200, 4};
+   } else if (difficulty >= 2) {
+      return {.2f, .034f, 20000, 16};
+   }
+   return {};
+}
+
+// Bot
+
+Bot::Bot(const BotLevel& level, const BotWeights& weights)
+   : weights(weights), level(level) {
+   worker = std::thread(&Bot::run, this);
+}
+
+Bot::~Bot() {
+   {
+      std::lock_guard lock {mutex};
+      running = false;
+   }
+   requested.notify_one();
+   worker.join();
+}
+
+// Run, the worker thread searching one request at a time
+
+void Bot::run() {
+   TranspositionTable table;
+
+   while (true) {
+      Request current;
+      {
+         std::unique_lock lock {mutex};
+         requested.wait(lock, [this] { return request.has_value() or not running; });
+         if (not running) {
+            return;
+         }
+         current = std::move(*request);
+         request.reset();
+      }
+      auto placement = find_best_placement(current.board, current.current, current.next, current.spawn, weights, level, table);
+
+      std::lock_guard lock {mutex};
+      result = std::move(placement);
+      result_id = current.id;
+   }
+}
+
+// Update, returns this frame's input. A new piece sends a search request, and the found key
+// presses are replayed with a release between presses so every press registers.
+
+Input Bot::update(const Simulation& sim, const Player& player, float dt) {
+   if (player.pieces != pieces) {
+      pieces = player.pieces;
+      plan.clear();
+      plan_index = 0;
+      waiting = true;
+
+      std::lock_guard lock {mutex};
+      request = Request{PlacementBoard(sim.tiles[player.board]), player.tetromino, player.next_tetromino, player.pos, pieces};
+      requested.notify_one();
+   }
+
+   if (waiting) {
+      std::lock_guard lock {mutex};
+      if (result_id == pieces) {
+         plan = (result ? result->inputs : std::vector<Input::Key>{Input::send});
+         waiting = false;
+      }
+   }
+   input_timer += dt;
+
+   Input input;
+   if (releasing) {
+      releasing = false;
+   } else if (not waiting and plan_index < plan.size() and input_timer >= level.input_interval) {
+      input.held = plan[plan_index++];
+      input_timer = 0.f;
+      releasing = true;
+   }
+   return input;
+}
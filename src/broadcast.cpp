@@ -0,0 +1,310 @@
+#include "broadcast.hpp"
+
+// Includes
+
+#include "util/connection.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fcntl.h>
+#include <mutex>
+#include <optional>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+// Constants
+
+namespace {
+   constexpr int max_pending_bytes = 1 << 16;
+   constexpr auto accept_interval = std::chrono::milliseconds(50);
+
+   // Global variables
+
+   std::thread worker;
+   std::mutex mutex;
+   std::condition_variable frame_ready;
+   std::optional<BroadcastFrame> mailbox;
+   bool running = false;
+   int listen_fd = -1;
+
+   // Row helpers
+
+   void write_row(ByteWriter& writer, const Board& board, int y) {
+      writer.data.insert(writer.data.end(), board.row(y), board.row(y) + board.width);
+   }
+
+   bool same_row(const Board& a, const Board& b, int y) {
+      return std::equal(a.row(y), a.row(y) + a.width, b.row(y));
+   }
+
+   // Same layout, a delta only describes a frame with the boards of the one before it
+
+   bool same_boards(const std::vector<Board>& a, const std::vector<Board>& b) {
+      return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Board& x, const Board& y) {
+         return x.width == y.width and x.height == y.height;
+      });
+   }
+
+   bool same_layout(const BroadcastFrame& a, const BroadcastFrame& b) {
+      return same_boards(a.tiles, b.tiles) and same_boards(a.next_tiles, b.next_tiles) and a.grid.x == b.grid.x and a.grid.y == b.grid.y
+         and a.player_count == b.player_count and a.versus == b.versus;
+   }
+
+   void read_row(ByteReader& reader, Board& board, int y) {
+      auto* row = board.edit_row(y);
+      for (int x = 0; x < board.width; ++x) {
+         row[x] = reader.read<std::uint8_t>();
+      }
+   }
+
+   // Worker, accepts subscribers and encodes each published frame once for all of them. A
+   // subscriber that can't keep up misses frames and is resynchronized with a keyframe, and
+   // every subscriber gets one when the boards change count or size.
+
+   void run_broadcast() {
+      std::vector<Connection> subscribers;
+      std::optional<BroadcastFrame> previous;
+
+      while (true) {
+         std::optional<BroadcastFrame> frame;
+         {
+            std::unique_lock lock {mutex};
+            frame_ready.wait_for(lock, accept_interval, [] { return mailbox.has_value() or not running; });
+            if (not running) {
+               break;
+            }
+            frame.swap(mailbox);
+         }
+
+         int fd;
+         while ((fd = accept(listen_fd, nullptr, nullptr)) >= 0) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+            subscribers.push_back({{}, fd});
+         }
+
+         if (not frame) {
+            continue;
+         }
+         if (previous and not same_layout(*frame, *previous)) {
+            previous.reset();
+         }
+         auto delta = (previous ? encode_broadcast_frame(*frame, &*previous) : std::vector<unsigned char>{});
+         std::vector<unsigned char> keyframe;
+
+         for (auto& subscriber : subscribers) {
+            if (not subscriber.pending.empty()) {
+               subscriber.needs_keyframe = true;
+            } else if (subscriber.needs_keyframe or not previous) {
+               if (keyframe.empty()) {
+                  keyframe = encode_broadcast_frame(*frame, nullptr);
+               }
+               queue_message(subscriber, keyframe);
+               subscriber.needs_keyframe = false;
+            } else {
+               queue_message(subscriber, delta);
+            }
+
+            if (not flush_connection(subscriber) or subscriber.pending.size() > max_pending_bytes) {
+               close_connection(subscriber);
+            }
+         }
+         std::erase_if(subscribers, [](const Connection& subscriber) { return subscriber.fd < 0; });
+         previous = std::move(frame);
+      }
+
+      for (auto& subscriber : subscribers) {
+         close_connection(subscriber);
+      }
+   }
+}
+
+// Encoding functions
+
+BroadcastFrame make_broadcast_frame(const Simulation& sim) {
+   BroadcastFrame frame;
+   frame.tiles = sim.tiles;
+   frame.next_tiles = sim.next_tiles;
+   frame.grid = sim.grid;
+   frame.score = sim.score;
+   frame.level = sim.level;
+   frame.player_count = sim.player_count;
+   frame.versus = sim.versus;
+   frame.lost = sim.lost;
+   frame.left_win = sim.left_win;
+
+   for (const auto& player : sim.players) {
+      frame.pieces.push_back({player.tetromino, player.color, player.pos, player.preview_y, player.waiting});
+   }
+   return frame;
+}
+
+std::vector<unsigned char> encode_broadcast_frame(const BroadcastFrame& frame, const BroadcastFrame* previous) {
+   ByteWriter writer;
+   writer.write<std::uint8_t>(previous == nullptr);
+
+   if (not previous) {
+      writer.write<std::uint8_t>(frame.grid.x);
+      writer.write<std::uint8_t>(frame.grid.y);
+      writer.write<std::uint8_t>(frame.player_count);
+      writer.write<std::uint8_t>(frame.versus);
+      writer.write<std::uint8_t>(frame.tiles.size());
+      writer.write<std::uint8_t>(frame.next_tiles.size());
+      writer.write<std::uint8_t>(frame.next_tiles.empty() ? 0 : frame.next_tiles[0].height);
+   }
+   writer.write<std::int32_t>(frame.score);
+   writer.write<std::uint8_t>(frame.level);
+   writer.write<std::uint8_t>(frame.lost | frame.left_win << 1);
+
+   writer.write<std::uint8_t>(frame.pieces.size());
+   for (const auto& piece : frame.pieces) {
+      int size = piece.tetromino.tiles.size();
+      std::uint16_t mask = 0;
+      for (int y = 0; y < size; ++y) {
+         for (int x = 0; x < size; ++x) {
+            mask |= piece.tetromino.tiles[y][x] << (y * size + x);
+         }
+      }
+      writer.write<std::uint8_t>(size);
+      writer.write<std::uint16_t>(mask);
+      writer.write<std::uint8_t>(piece.tetromino.rotation);
+      writer.write<std::int8_t>(piece.pos.x);
+      writer.write<std::int8_t>(piece.pos.y);
+      writer.write<std::int8_t>(piece.preview_y);
+      writer.write<std::uint8_t>(piece.color);
+      writer.write<std::uint8_t>(piece.waiting);
+   }
+
+   ByteWriter rows;
+   std::uint16_t row_count = 0;
+   auto write_boards = [&](const std::vector<Board>& boards, const std::vector<Board>* previous_boards, int first_board) {
+      for (int i = 0; i < boards.size(); ++i) {
+         // A board still sharing its tiles with the previous frame hasn't changed
+
+         if (previous_boards and boards[i].shares_tiles((*previous_boards)[i])) {
+            continue;
+         }
+
+         for (int y = 0; y < boards[i].height; ++y) {
+            if (previous_boards and same_row(boards[i], (*previous_boards)[i], y)) {
+               continue;
+            }
+            rows.write<std::uint8_t>(first_board + i);
+            rows.write<std::uint8_t>(y);
+            write_row(rows, boards[i], y);
+            row_count++;
+         }
+      }
+   };
+   write_boards(frame.tiles, (previous ? &previous->tiles : nullptr), 0);
+   write_boards(frame.next_tiles, (previous ? &previous->next_tiles : nullptr), frame.tiles.size());
+
+   writer.write<std::uint16_t>(row_count);
+   writer.data.insert(writer.data.end(), rows.data.begin(), rows.data.end());
+   return writer.data;
+}
+
+bool apply_broadcast_frame(ByteReader& reader, Simulation& sim) {
+   bool keyframe = reader.read<std::uint8_t>();
+
+   if (keyframe) {
+      sim = Simulation();
+      sim.grid.x = reader.read<std::uint8_t>();
+      sim.grid.y = reader.read<std::uint8_t>();
+      sim.player_count = reader.read<std::uint8_t>();
+      sim.versus = reader.read<std::uint8_t>();
+      int board_count = reader.read<std::uint8_t>();
+      int next_count = reader.read<std::uint8_t>();
+      int next_size = reader.read<std::uint8_t>();
+
+      sim.tiles.assign(board_count, Board(sim.grid.x, sim.grid.y));
+      sim.next_tiles.assign(next_count, Board(next_size, next_size));
+   } else if (sim.tiles.empty()) {
+      return false;
+   }
+   sim.score = reader.read<std::int32_t>();
+   sim.level = reader.read<std::uint8_t>();
+   int flags = reader.read<std::uint8_t>();
+   sim.lost = flags & 1;
+   sim.left_win = flags & 2;
+
+   int piece_count = reader.read<std::uint8_t>();
+   sim.players.resize(piece_count);
+   for (int i = 0; i < piece_count; ++i) {
+      auto& player = sim.players[i];
+      int size = std::min<int>(reader.read<std::uint8_t>(), 4);
+      std::uint16_t mask = reader.read<std::uint16_t>();
+
+      player.id = i;
+      player.board = sim.versus and i > sim.player_count / 2;
+      player.tetromino.tiles.assign(size, std::vector<bool>(size));
+      for (int y = 0; y < size; ++y) {
+         for (int x = 0; x < size; ++x) {
+            player.tetromino.tiles[y][x] = mask >> (y * size + x) & 1;
+         }
+      }
+      player.tetromino.rotation = reader.read<std::uint8_t>();
+      player.pos.x = reader.read<std::int8_t>();
+      player.pos.y = reader.read<std::int8_t>();
+      player.preview_y = reader.read<std::int8_t>();
+      player.color = reader.read<std::uint8_t>();
+      player.waiting = reader.read<std::uint8_t>();
+   }
+
+   int row_count = reader.read<std::uint16_t>();
+   for (int i = 0; i < row_count and not reader.failed; ++i) {
+      int board = reader.read<std::uint8_t>();
+      int y = reader.read<std::uint8_t>();
+      auto& boards = (board < sim.tiles.size() ? sim.tiles : sim.next_tiles);
+      board -= (board < sim.tiles.size() ? 0 : sim.tiles.size());
+
+      if (board >= boards.size() or y >= boards[board].height) {
+         return false;
+      }
+      read_row(reader, boards[board], y);
+   }
+   return not reader.failed;
+}
+
+// Broadcast functions
+
+void start_broadcast(int port) {
+   stop_broadcast();
+   listen_fd = listen_on(port);
+   if (listen_fd < 0) {
+      return;
+   }
+   running = true;
+   worker = std::thread(run_broadcast);
+}
+
+void stop_broadcast() {
+   if (not worker.joinable()) {
+      return;
+   }
+   {
+      std::lock_guard lock {mutex};
+      running = false;
+   }
+   frame_ready.notify_one();
+   worker.join();
+   close(listen_fd);
+   listen_fd = -1;
+}
+
+bool is_broadcasting() {
+   return running;
+}
+
+// Broadcast simulation, replaces any frame the worker hasn't picked up yet so the caller
+// never waits on subscribers
+
+void broadcast_simulation(const Simulation& sim) {
+   auto frame = make_broadcast_frame(sim);
+   {
+      std::lock_guard lock {mutex};
+      mailbox = std::move(frame);
+   }
+   frame_ready.notify_one();
+}
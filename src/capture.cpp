@@ -0,0 +1,249 @@
+#include "capture.hpp"
+
+// Includes
+
+#include "util/thread_pool.hpp"
+#include <raylib.h>
+#include <rlgl.h>
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unistd.h>
+#include <vector>
+
+// Constants
+
+namespace {
+   constexpr int pixel_buffer_count = 3;
+   constexpr int bytes_per_pixel = 4;
+   constexpr int raw_frame_header = 2 * sizeof(std::uint32_t);
+   constexpr GLuint64 stop_timeout = 1000000000; // Nanoseconds
+
+   // Pixel buffer, a frame the GPU copies into while the game goes on. The fence signals once
+   // the copy is done.
+
+   struct PixelBuffer {
+      GLuint buffer = 0;
+      GLsync fence = nullptr;
+      int width = 0, height = 0;
+   };
+
+   // Global variables
+
+   CaptureConfig config;
+   std::unique_ptr<ThreadPool> pool;
+   std::array<PixelBuffer, pixel_buffer_count> pixel_buffers;
+   int next_pixel_buffer = 0;
+   bool capturing = false, raw = false;
+   int raw_file = -1;
+   off_t raw_offset = 0;
+   std::uint64_t frame_index = 0, dropped = 0;
+   std::atomic<std::uint64_t> written = 0, failed = 0;
+
+   std::mutex mutex;
+   std::condition_variable frame_freed;
+   std::vector<std::vector<unsigned char>> free_frames;
+   int frame_count = 0;
+
+   void release(std::vector<unsigned char> frame) {
+      {
+         std::lock_guard lock {mutex};
+         free_frames.push_back(std::move(frame));
+      }
+      frame_freed.notify_one();
+   }
+
+   // Encode, runs on a worker. Raw frames go to the offset they were given, so workers can
+   // finish in any order.
+
+   void encode(std::vector<unsigned char>& frame, int width, int height, std::uint64_t index, off_t offset) {
+      bool ok = false;
+      if (raw) {
+         std::uint32_t size[] {std::uint32_t(width), std::uint32_t(height)};
+         ok = pwrite(raw_file, size, sizeof(size), offset) == sizeof(size) and pwrite(raw_file, frame.data(), frame.size(), offset + sizeof(size)) == frame.size();
+      } else {
+         // The window's alpha isn't meaningful, and a PNG would show it
+
+         for (std::size_t i = bytes_per_pixel - 1; i < frame.size(); i += bytes_per_pixel) {
+            frame[i] = 255;
+         }
+         Image image {frame.data(), width, height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+         int size = 0;
+         unsigned char* png = ExportImageToMemory(image, ".png", &size);
+
+         char name[32];
+         std::snprintf(name, sizeof(name), "frame_%06llu.png", (unsigned long long)index);
+         std::FILE* file = std::fopen((std::filesystem::path(config.path) / name).c_str(), "wb");
+         ok = png and file and std::fwrite(png, 1, size, file) == size;
+         if (file) {
+            std::fclose(file);
+         }
+         MemFree(png);
+      }
+      (ok ? written : failed)++;
+   }
+
+   // Hand off, copies a finished pixel buffer into a free frame, flipping it top to bottom,
+   // and queues it for encoding. With the queue full the frame is dropped, or waited for
+   // when blocking.
+
+   void hand_off(PixelBuffer& pixel_buffer) {
+      std::vector<unsigned char> frame;
+      {
+         std::unique_lock lock {mutex};
+         if (free_frames.empty() and frame_count >= config.queue_frames) {
+            if (not config.block) {
+               dropped++;
+               return;
+            }
+            frame_freed.wait(lock, [] { return not free_frames.empty(); });
+         }
+
+         if (free_frames.empty()) {
+            frame_count++;
+         } else {
+            frame = std::move(free_frames.back());
+            free_frames.pop_back();
+         }
+      }
+
+      int width = pixel_buffer.width, height = pixel_buffer.height, pitch = width * bytes_per_pixel;
+      frame.resize(pitch * height);
+
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffer.buffer);
+      auto* pixels = static_cast<const unsigned char*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frame.size(), GL_MAP_READ_BIT));
+      if (pixels) {
+         for (int y = 0; y < height; ++y) {
+            std::memcpy(frame.data() + y * pitch, pixels + (height - 1 - y) * pitch, pitch);
+         }
+         glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      }
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+      if (not pixels) {
+         failed++;
+         release(std::move(frame));
+         return;
+      }
+
+      std::uint64_t index = frame_index++;
+      off_t offset = raw_offset;
+      raw_offset += raw_frame_header + frame.size();
+
+      pool->submit([frame = std::move(frame), width, height, index, offset]() mutable {
+         encode(frame, width, height, index, offset);
+         release(std::move(frame));
+      });
+   }
+}
+
+// Capture functions
+
+void start_capture(const CaptureConfig& capture_config) {
+   stop_capture();
+   config = capture_config;
+   config.queue_frames = std::max(config.queue_frames, 1);
+   raw = std::filesystem::path(config.path).extension() == ".raw";
+
+   if (raw) {
+      raw_file = open(config.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (raw_file < 0) {
+         TraceLog(LOG_WARNING, "CAPTURE: Could not open %s", config.path.c_str());
+         return;
+      }
+   } else {
+      std::error_code error;
+      std::filesystem::create_directories(config.path, error);
+   }
+
+   for (auto& pixel_buffer : pixel_buffers) {
+      glGenBuffers(1, &pixel_buffer.buffer);
+   }
+   pool = std::make_unique<ThreadPool>(config.threads);
+   next_pixel_buffer = 0;
+   raw_offset = 0;
+   frame_index = dropped = 0;
+   written = failed = 0;
+   capturing = true;
+}
+
+void stop_capture() {
+   if (not capturing) {
+      return;
+   }
+
+   // Frames still being read are finished, so the capture ends on the last frame drawn
+
+   for (int i = 0; i < pixel_buffer_count; ++i) {
+      auto& pixel_buffer = pixel_buffers[(next_pixel_buffer + i) % pixel_buffer_count];
+      if (pixel_buffer.fence) {
+         glClientWaitSync(pixel_buffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, stop_timeout);
+         glDeleteSync(pixel_buffer.fence);
+         pixel_buffer.fence = nullptr;
+         hand_off(pixel_buffer);
+      }
+      glDeleteBuffers(1, &pixel_buffer.buffer);
+      pixel_buffer = {};
+   }
+   pool->wait();
+   pool.reset();
+   free_frames.clear();
+   frame_count = 0;
+   capturing = false;
+
+   if (raw_file >= 0) {
+      close(raw_file);
+      raw_file = -1;
+   }
+   std::printf("Captured %llu frames to %s, %llu dropped, %llu failed to write\n", (unsigned long long)written.load(), config.path.c_str(),
+      (unsigned long long)dropped, (unsigned long long)failed.load());
+}
+
+bool capture_running() {
+   return capturing;
+}
+
+// Capture frame, the pixel buffer read a few frames ago is handed off and this frame is read
+// into it. A buffer the GPU hasn't finished yet drops this frame rather than wait.
+
+void capture_frame() {
+   if (not capturing) {
+      return;
+   }
+   auto& pixel_buffer = pixel_buffers[next_pixel_buffer];
+
+   if (pixel_buffer.fence) {
+      if (glClientWaitSync(pixel_buffer.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+         dropped++;
+         return;
+      }
+      glDeleteSync(pixel_buffer.fence);
+      pixel_buffer.fence = nullptr;
+      hand_off(pixel_buffer);
+   }
+
+   int width = GetRenderWidth(), height = GetRenderHeight();
+   rlDrawRenderBatchActive();
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffer.buffer);
+   if (pixel_buffer.width != width or pixel_buffer.height != height) {
+      glBufferData(GL_PIXEL_PACK_BUFFER, width * height * bytes_per_pixel, nullptr, GL_STREAM_READ);
+      pixel_buffer.width = width;
+      pixel_buffer.height = height;
+   }
+   glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+   pixel_buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+   next_pixel_buffer = (next_pixel_buffer + 1) % pixel_buffer_count;
+}
@@ -0,0 +1,302 @@
+#include "checksum.hpp"
+
+// Includes
+
+#include "util/bytes.hpp"
+#include "simulation.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+// Constants
+
+namespace {
+   constexpr std::uint32_t magic = 0x53435042; // "BPCS"
+   constexpr std::uint16_t version = 1;
+   constexpr long header_size = sizeof(std::uint32_t) + 2 * sizeof(std::uint16_t);
+
+   // Record, one logged tick
+
+   struct Record {
+      std::uint64_t tick = 0, chain = 0;
+      std::array<std::uint64_t, StateChecksum::fields> hashes {};
+   };
+
+   // Global variables
+
+   std::FILE* file = nullptr;
+   std::uint64_t chain = 0;
+
+   // Hash, folds values into a running hash
+
+   struct Hash {
+      std::uint64_t value = 0;
+
+      void add(std::uint64_t x) {
+         value = mix(value ^ x);
+      }
+
+      void add_float(float x) {
+         add(std::bit_cast<std::uint32_t>(x));
+      }
+
+      void add_bytes(const unsigned char* data, std::size_t size) {
+         std::size_t i = 0;
+         for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t)) {
+            std::uint64_t chunk;
+            std::memcpy(&chunk, data + i, sizeof(chunk));
+            add(chunk);
+         }
+         std::uint64_t tail = 0;
+         if (i < size) {
+            std::memcpy(&tail, data + i, size - i);
+         }
+         add(tail ^ size);
+      }
+
+      // A tetromino is its shape as bits plus its size and rotation
+
+      void add_tetromino(const Tetromino& tetromino) {
+         int size = tetromino.tiles.size();
+         std::uint64_t bits = 0;
+         for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+               bits |= std::uint64_t(tetromino.tiles[y][x]) << (y * size + x);
+            }
+         }
+         add(bits | std::uint64_t(size) << 32 | std::uint64_t(tetromino.rotation) << 40);
+      }
+   };
+
+   std::uint64_t hash_board(const Board& board) {
+      Hash hash;
+      hash.add(std::uint64_t(board.width) << 32 | board.height);
+      for (int y = 0; y < board.height; ++y) {
+         hash.add_bytes(board.row(y), board.width);
+      }
+      return hash.value;
+   }
+
+   const char* field_name(int field) {
+      static constexpr const char* names[] {"tiles", "garbage", "pieces", "positions", "timers", "counters", "rng"};
+      return (field < std::size(names) ? names[field] : "unknown");
+   }
+
+   // Log reader, reads records by index without loading the log
+
+   struct LogReader {
+      std::FILE* in = nullptr;
+      long count = 0;
+
+      bool open(const std::string& path) {
+         in = std::fopen(path.c_str(), "rb");
+         if (not in) {
+            return false;
+         }
+         std::uint32_t header_magic = 0;
+         std::uint16_t header_version = 0, field_count = 0;
+         std::fread(&header_magic, sizeof(header_magic), 1, in);
+         std::fread(&header_version, sizeof(header_version), 1, in);
+         std::fread(&field_count, sizeof(field_count), 1, in);
+         if (header_magic != magic or header_version != version or field_count != StateChecksum::fields) {
+            return false;
+         }
+
+         std::fseek(in, 0, SEEK_END);
+         count = (std::ftell(in) - header_size) / long(sizeof(Record));
+         return true;
+      }
+
+      Record read(long index) {
+         Record record;
+         std::fseek(in, header_size + index * long(sizeof(Record)), SEEK_SET);
+         std::fread(&record, sizeof(record), 1, in);
+         return record;
+      }
+
+      ~LogReader() {
+         if (in) {
+            std::fclose(in);
+         }
+      }
+   };
+}
+
+// State checksum
+
+std::uint64_t StateChecksum::combined() const {
+   Hash hash;
+   for (auto value : hashes) {
+      hash.add(value);
+   }
+   return hash.value;
+}
+
+// Checksummer
+
+StateChecksum Checksummer::update(const Simulation& sim) {
+   StateChecksum checksum;
+   if (hashed.size() != sim.tiles.size()) {
+      hashed.assign(sim.tiles.size(), Board());
+      board_hashes.assign(sim.tiles.size(), 0);
+   }
+
+   // Tiles, with the index of pieces in flight on shared boards
+
+   Hash tiles;
+   for (int i = 0; i < sim.tiles.size(); ++i) {
+      if (not sim.tiles[i].shares_tiles(hashed[i])) {
+         hashed[i] = sim.tiles[i];
+         board_hashes[i] = hash_board(sim.tiles[i]);
+      }
+      tiles.add(board_hashes[i]);
+   }
+   for (const auto& cells : sim.active) {
+      tiles.add_bytes(cells.data(), cells.size());
+   }
+   checksum.hashes[StateChecksum::tiles] = tiles.value;
+
+   Hash garbage;
+   for (const auto& lines : sim.garbage) {
+      garbage.add(lines.size());
+      garbage.add_bytes(reinterpret_cast<const unsigned char*>(lines.data()), lines.size() * sizeof(std::uint64_t));
+   }
+   garbage.add_bytes(reinterpret_cast<const unsigned char*>(sim.outbox.data()), sim.outbox.size() * sizeof(std::uint64_t));
+   checksum.hashes[StateChecksum::garbage] = garbage.value;
+
+   // Players, split so a mismatch says whether the pieces, where they are or the timers parted
+
+   Hash pieces, positions, timers;
+   for (const auto& player : sim.players) {
+      pieces.add_tetromino(player.tetromino);
+      pieces.add_tetromino(player.next_tetromino);
+      pieces.add(player.bag.size());
+      for (const auto& tetromino : player.bag) {
+         pieces.add_tetromino(tetromino);
+      }
+      pieces.add(player.color | player.next_color << 8 | player.pieces << 16);
+
+      positions.add_float(player.pos.x);
+      positions.add_float(player.pos.y);
+      positions.add(std::uint64_t(player.preview_y) << 32 | player.board);
+      positions.add(player.previous_input.held | player.soft_drop << 8 | player.hard_drop << 9 | player.waiting << 10);
+
+      timers.add_float(player.down_timer);
+      timers.add_float(player.left_timer);
+      timers.add_float(player.right_timer);
+      timers.add_float(player.soft_drop_timer);
+   }
+   timers.add_float(sim.time);
+   timers.add_float(sim.rise_timer);
+   timers.add_float(sim.down_after);
+   checksum.hashes[StateChecksum::pieces] = pieces.value;
+   checksum.hashes[StateChecksum::positions] = positions.value;
+   checksum.hashes[StateChecksum::timers] = timers.value;
+
+   Hash counters;
+   for (std::int64_t value : {sim.score, sim.total_clears, sim.combo_count, sim.difficult_count, sim.level, sim.dig_hole, sim.dug}) {
+      counters.add(value);
+   }
+   counters.add(sim.dig_rows);
+   counters.add(sim.lost | sim.left_win << 1 | sim.dig << 2);
+   checksum.hashes[StateChecksum::counters] = counters.value;
+
+   // The engine's next output stands in for its state, which isn't exposed. Runs that drew a
+   // different number of values get different outputs.
+
+   auto rng = sim.rng;
+   checksum.hashes[StateChecksum::rng] = rng();
+   return checksum;
+}
+
+// Checksum log functions
+
+void start_checksum_log(const std::string& path) {
+   stop_checksum_log();
+   file = std::fopen(path.c_str(), "wb");
+   if (not file) {
+      return;
+   }
+   std::uint16_t field_count = StateChecksum::fields;
+   std::fwrite(&magic, sizeof(magic), 1, file);
+   std::fwrite(&version, sizeof(version), 1, file);
+   std::fwrite(&field_count, sizeof(field_count), 1, file);
+   chain = 0;
+}
+
+void stop_checksum_log() {
+   if (file) {
+      std::fclose(file);
+      file = nullptr;
+   }
+}
+
+bool is_logging_checksums() {
+   return file;
+}
+
+void log_checksum(std::uint64_t tick, const StateChecksum& checksum) {
+   if (not file) {
+      return;
+   }
+   chain = mix(chain ^ checksum.combined());
+   Record record {tick, chain, checksum.hashes};
+   std::fwrite(&record, sizeof(record), 1, file);
+}
+
+// Bisect checksums. A chain stays different once it differs, so the first differing record is
+// found in a logarithmic number of reads however long the runs were.
+
+int bisect_checksums(const std::string& a, const std::string& b, std::FILE* out) {
+   LogReader logs[2];
+   for (int i = 0; i < 2; ++i) {
+      if (not logs[i].open((i == 0 ? a : b))) {
+         std::fprintf(out, "Could not read checksum log %s\n", (i == 0 ? a : b).c_str());
+         return 2;
+      }
+   }
+
+   long count = std::min(logs[0].count, logs[1].count), reads = 0;
+   auto same = [&](long index) {
+      reads++;
+      Record first = logs[0].read(index), second = logs[1].read(index);
+      return first.tick == second.tick and first.chain == second.chain;
+   };
+
+   if (count == 0 or same(count - 1)) {
+      std::fprintf(out, "No divergence in %li ticks\n", count);
+      if (logs[0].count != logs[1].count) {
+         std::fprintf(out, "%s has %li more ticks\n", (logs[0].count > logs[1].count ? a : b).c_str(), std::labs(logs[0].count - logs[1].count));
+      }
+      return 0;
+   }
+
+   long low = 0, high = count - 1;
+   while (low < high) {
+      long middle = low + (high - low) / 2;
+      if (same(middle)) {
+         low = middle + 1;
+      } else {
+         high = middle;
+      }
+   }
+
+   Record first = logs[0].read(low), second = logs[1].read(low);
+   if (first.tick != second.tick) {
+      std::fprintf(out, "Logs went out of step at record %li: tick %llu against tick %llu\n", low, (unsigned long long)first.tick,
+         (unsigned long long)second.tick);
+      return 1;
+   }
+
+   std::fprintf(out, "First divergence at tick %llu (record %li of %li, %li reads)\n", (unsigned long long)first.tick, low, count, reads);
+   std::fprintf(out, "Fields that differ:");
+   for (int field = 0; field < StateChecksum::fields; ++field) {
+      if (first.hashes[field] != second.hashes[field]) {
+         std::fprintf(out, " %s", field_name(field));
+      }
+   }
+   std::fprintf(out, "\n");
+   return 1;
+}
@@ -0,0 +1,169 @@
+#include "env_server.hpp"
+
+// Includes
+
+#include "util/thread_pool.hpp"
+#include "simulation.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+// Constants
+
+namespace {
+   constexpr Vector2 single_mode_grid {12, 22};
+   constexpr std::uint64_t alignment = 64;
+   constexpr long wait_timeout_ns = 100'000'000;
+
+   std::uint64_t align(std::uint64_t offset) {
+      return (offset + alignment - 1) / alignment * alignment;
+   }
+
+   // Futex helpers, shared between processes so the private flag isn't used
+
+   void futex_wait(std::atomic<std::uint32_t>& word, std::uint32_t value) {
+      timespec timeout {0, wait_timeout_ns};
+      syscall(SYS_futex, &word, FUTEX_WAIT, value, &timeout, nullptr, 0);
+   }
+
+   void futex_wake(std::atomic<std::uint32_t>& word) {
+      syscall(SYS_futex, &word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+   }
+
+   std::uint16_t piece_mask(const Tetromino& tetromino) {
+      std::uint16_t mask = 0;
+      for (int y = 0; y < tetromino.tiles.size(); ++y) {
+         for (int x = 0; x < tetromino.tiles.size(); ++x) {
+            mask |= tetromino.tiles[y][x] << (y * 4 + x);
+         }
+      }
+      return mask;
+   }
+
+   // Env, one game with the seed of its next restart
+
+   struct Env {
+      Simulation sim;
+      unsigned int next_seed = 0;
+   };
+
+   // Write observation, straight into the shared arrays
+
+   void write_observation(const EnvHeader& header, unsigned char* region, int i, const Simulation& sim) {
+      auto* board = region + header.boards + std::uint64_t(i) * header.width * header.height;
+      for (int y = 0; y < header.height; ++y) {
+         const unsigned char* row = sim.tiles[0].row(y);
+         for (int x = 0; x < header.width; ++x) {
+            board[y * header.width + x] = row[x] != Tile::off;
+         }
+      }
+
+      const Player& player = sim.players[0];
+      auto& state = reinterpret_cast<EnvState*>(region + header.states)[i];
+      state.current = piece_mask(player.tetromino);
+      state.next = piece_mask(player.next_tetromino);
+      state.x = player.pos.x;
+      state.y = player.pos.y;
+      state.rotation = player.tetromino.rotation;
+      state.level = sim.level;
+      state.score = sim.score;
+   }
+
+   // Step env, one tick with the trainer's action, restarting a lost game with a new seed
+
+   void step_env(const EnvHeader& header, unsigned char* region, int i, Env& env, const EnvConfig& config) {
+      auto* actions = region + header.actions;
+      auto* rewards = reinterpret_cast<float*>(region + header.rewards);
+      auto* dones = region + header.dones;
+
+      int score = env.sim.score;
+      std::vector<Input> inputs {{actions[i]}};
+      env.sim.step(inputs, tick_time);
+      env.sim.sounds.clear();
+
+      rewards[i] = env.sim.score - score;
+      dones[i] = env.sim.lost;
+      if (env.sim.lost) {
+         env.sim = Simulation(single_mode_grid, 1, false, env.next_seed);
+         env.next_seed += config.count;
+      }
+      write_observation(header, region, i, env.sim);
+   }
+}
+
+// Run env server
+
+int run_env_server(const EnvConfig& config) {
+   std::uint64_t width = single_mode_grid.x, height = single_mode_grid.y, count = config.count;
+   std::uint64_t boards = align(sizeof(EnvHeader));
+   std::uint64_t states = align(boards + count * width * height);
+   std::uint64_t actions = align(states + sizeof(EnvState) * count);
+   std::uint64_t rewards = align(actions + count);
+   std::uint64_t dones = align(rewards + sizeof(float) * count);
+   std::uint64_t size = align(dones + count);
+
+   int fd = shm_open(config.name.c_str(), O_CREAT | O_RDWR, 0600);
+   if (fd < 0 or ftruncate(fd, size) != 0) {
+      std::fprintf(stderr, "Could not create shared memory %s\n", config.name.c_str());
+      return 1;
+   }
+   void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close(fd);
+   if (mapped == MAP_FAILED) {
+      shm_unlink(config.name.c_str());
+      return 1;
+   }
+
+   auto* region = static_cast<unsigned char*>(mapped);
+   auto& header = *new (region) EnvHeader {0, std::uint32_t(count), std::uint32_t(width), std::uint32_t(height),
+      size, boards, states, actions, rewards, dones, 0, 0, 0};
+
+   std::vector<Env> envs (config.count);
+   for (int i = 0; i < config.count; ++i) {
+      envs[i].sim = Simulation(single_mode_grid, 1, false, config.seed + i);
+      envs[i].next_seed = config.seed + i + config.count;
+      write_observation(header, region, i, envs[i].sim);
+   }
+
+   std::atomic_thread_fence(std::memory_order_release);
+   header.magic = EnvHeader::expected_magic;
+
+   ThreadPool pool {config.threads};
+   int chunk = (config.count + pool.size() - 1) / pool.size();
+   std::printf("serving %d environments in %s (%llu bytes)\n", config.count, config.name.c_str(), (unsigned long long)size);
+   std::fflush(stdout);
+
+   std::uint32_t completed = 0;
+   while (not header.stop) {
+      std::uint32_t requested = header.requested.load(std::memory_order_acquire);
+      if (requested == completed) {
+         futex_wait(header.requested, completed);
+         continue;
+      }
+
+      for (int first = 0; first < config.count; first += chunk) {
+         pool.submit([&, first] {
+            for (int i = first; i < std::min(first + chunk, config.count); ++i) {
+               step_env(header, region, i, envs[i], config);
+            }
+         });
+      }
+      pool.wait();
+
+      completed = requested;
+      header.completed.store(completed, std::memory_order_release);
+      futex_wake(header.completed);
+   }
+
+   munmap(mapped, size);
+   shm_unlink(config.name.c_str());
+   return 0;
+}
@@ -3,36 +3,109 @@
 // Includes
 
 #include "util/audio.hpp"
+#include "broadcast.hpp"
+#include "capture.hpp"
+#include "checksum.hpp"
+#include "game_state.hpp"
+#include "grid_state.hpp"
+#include "history.hpp"
 #include "menu_state.hpp"
+#include "royale_state.hpp"
+#include "telemetry.hpp"
 #include <raylib.h>
+#include <algorithm>
 #include <cstdlib>
+#include <random>
 
 // Constants
 
 namespace {
    constexpr const char* title = "Block Placer";
    constexpr Vector2 screen {636, 700};
+   constexpr Vector2 versus_mode_grid {12, 22};
+   constexpr Vector2 dig_mode_grid {12, 22};
+   constexpr int co_op_grid_height = 22, co_op_min_width = 18, co_op_width_per_player = 4;
    constexpr int target_fps = 60;
+   constexpr double idle_wait = 1.0 / 30.0;
 }
 
 // Constructors
 
-Game::Game() {
+Game::Game(const Options& options) {
    srand(time(nullptr));
    InitWindow(screen.x, screen.y, title);
    InitAudioDevice();
-   SetTargetFPS(target_fps);
+
+   // Input is only read once a frame, so a faster frame rate is what shortens the wait for a
+   // press to be seen and its sound to start
+
+   SetTargetFPS(options.low_latency_fps.value_or(target_fps));
    SetExitKey(0);
 
    auto icon = LoadImage("assets/icon.png");
    SetWindowIcon(icon);
    load_audio();
 
-   states.push_back(std::make_unique<MenuState>());
+   if (options.measure_latency) {
+      start_latency_measurement();
+   }
+
+   if (options.broadcast_port) {
+      start_broadcast(*options.broadcast_port);
+   }
+
+   open_history(history_file);
+
+   if (options.capture and not options.capture->path.empty()) {
+      start_capture(*options.capture);
+   }
+
+   if (options.telemetry_file) {
+      start_telemetry(*options.telemetry_file);
+   }
+
+   if (options.checksum_file) {
+      start_checksum_log(*options.checksum_file);
+   }
+
+   Simulation spectated;
+   auto viewer = std::make_unique<Spectator>();
+   viewer->player = options.play_online;
+
+   if (options.watch_count > 0) {
+      states.push_back(std::make_unique<GridState>(options.watch_count, (options.seed ? *options.seed : std::random_device{}()), options.threads.value_or(0)));
+   } else if (options.co_op_players > 0) {
+      Vector2 grid {(float)std::max(co_op_min_width, co_op_width_per_player * options.co_op_players + 2), co_op_grid_height};
+      states.push_back(std::make_unique<GameState>(grid, options.co_op_players, false));
+   } else if (options.royale) {
+      RoyaleConfig config = *options.royale;
+      if (not options.seed) {
+         config.seed = std::random_device{}();
+      }
+      states.push_back(std::make_unique<RoyaleState>(config));
+   } else if (options.dig) {
+      Simulation sim(dig_mode_grid, 1, false, (options.seed ? *options.seed : std::random_device{}()));
+      sim.start_dig();
+      states.push_back(std::make_unique<GameState>(sim));
+   } else if (options.net) {
+      states.push_back(std::make_unique<GameState>(versus_mode_grid, *options.net));
+   } else if (options.spectate and viewer->connect(options.spectate->first, options.spectate->second, spectated)) {
+      states.push_back(std::make_unique<GameState>(spectated, std::move(viewer)));
+   } else if (auto savestate = read_savestate(suspend_file)) {
+      states.push_back(std::make_unique<GameState>(*savestate));
+   } else {
+      states.push_back(std::make_unique<MenuState>());
+   }
 }
 
 Game::~Game() {
+   stop_broadcast();
+   stop_telemetry();
+   stop_checksum_log();
+   close_history();
+   stop_latency_measurement();
    unload_audio();
+   stop_capture();
    CloseWindow();
    CloseAudioDevice();
 }
@@ -40,6 +113,8 @@ Game::~Game() {
 // Run function
 
 void Game::run() {
+   bool drawn_idle = false, waited = false;
+
    while (not WindowShouldClose()) {
       if (states.front()->quit) {
          states.front()->change_state(states);
@@ -52,6 +127,31 @@ void Game::run() {
 
       update_music();
       states.front()->update();
+
+      // An idle state is drawn once more and then only polled, which keeps input and the
+      // music stream serviced without redrawing the same frame. A capture keeps every frame so
+      // its clips play back at the frame rate.
+
+      bool idle = states.front()->idle() and not IsWindowResized() and not capture_running();
+      if (idle and drawn_idle) {
+         PollInputEvents();
+         WaitTime(idle_wait);
+         waited = true;
+         continue;
+      }
+
+      // The first frame after waiting measures the whole wait, draw it twice so the next
+      // update gets a normal frame time
+
+      if (waited) {
+         states.front()->render();
+         waited = false;
+      }
       states.front()->render();
+      drawn_idle = idle;
+   }
+
+   if (not states.empty()) {
+      states.front()->suspend();
    }
 }
@@ -5,10 +5,15 @@
 #include "util/audio.hpp"
 #include "menu_state.hpp"
 #include "util/file.hpp"
+#include "broadcast.hpp"
+#include "capture.hpp"
+#include "history.hpp"
+#include "solver.hpp"
+#include "telemetry.hpp"
 #include <algorithm>
+#include <cstdio>
+#include <ctime>
 #include <random>
-#include <stack>
-#include <unordered_map>
 
 using namespace std::string_literals;
 using namespace std::string_view_literals;
@@ -16,124 +21,54 @@ using namespace std::string_view_literals;
 // Constants
 
 namespace {
-   // Tetromino width and height must be the same!
-   static const std::vector<Tetromino> tetrominoes {
-      {{{1, 1}, {1, 1}}},
-      {{{0, 0, 1}, {1, 1, 1}, {0, 0, 0}}},
-      {{{1, 0, 0}, {1, 1, 1}, {0, 0, 0}}},
-      {{{0, 1, 1}, {1, 1, 0}, {0, 0, 0}}},
-      {{{1, 1, 0}, {0, 1, 1}, {0, 0, 0}}},
-      {{{0, 1, 0}, {1, 1, 1}, {0, 0, 0}}},
-      {{{0, 0, 0, 0}, {1, 1, 1, 1}, {0, 0, 0, 0}, {0, 0, 0, 0}}},
-   };
-
-   static const std::unordered_map<int, std::vector<Vector2>> wall_kick_data_jlstz {
-      {0, {{0, 0}, {-1, 0}, {-1, -1}, {-1, +2}, {0, -2}}},
-      {1, {{0, 0}, {+1, 0}, {+1, +1}, {+1, +2}, {0, -2}}},
-      {2, {{0, 0}, {+1, 0}, {+1, -1}, {+1, +2}, {0, -2}}},
-      {3, {{0, 0}, {-1, 0}, {-1, +1}, {-1, +2}, {0, -2}}},
-   };
-
-   static const std::unordered_map<int, std::vector<Vector2>> wall_kick_data_i {
-      {0, {{0, 0}, {-2, 0}, {+1, 0}, {-2, +1}, {+1, -2}}},
-      {1, {{0, 0}, {-1, 0}, {+2, 0}, {-1, -2}, {+2, +1}}},
-      {2, {{0, 0}, {+2, 0}, {-1, 0}, {+2, -1}, {-1, +2}}},
-      {3, {{0, 0}, {+1, 0}, {-2, 0}, {+1, +2}, {-2, -1}}},
-   };
-
-   static const std::vector<Color> colors {
-      RED, ORANGE, YELLOW, GREEN, BLUE, PURPLE, PINK,
-   };
-
-   static const std::vector<float> level_speeds {
-      1.1f, 1.f, .9f, .8f, .7f, .6f, .55f, .5f, .45f, .4f, .35f, .3f, .25f, .2f, .1f, .085f
-   };
-
    static const std::vector<Keys> keybinds {
       {KEY_W, KEY_A, KEY_D, KEY_S, KEY_SPACE},
       {KEY_UP, KEY_LEFT, KEY_RIGHT, KEY_DOWN, KEY_ENTER}
    };
 
-   constexpr Color versus_tile_color {64, 64, 64, 255};
+   constexpr Keys gamepad_buttons {
+      GAMEPAD_BUTTON_LEFT_FACE_UP, GAMEPAD_BUTTON_LEFT_FACE_LEFT, GAMEPAD_BUTTON_LEFT_FACE_RIGHT, GAMEPAD_BUTTON_LEFT_FACE_DOWN, GAMEPAD_BUTTON_RIGHT_FACE_DOWN
+   };
+
    constexpr Vector2 next_grid {6, 6};
-   constexpr int rows_for_level_up = 9;
-   constexpr float keys_down_for_press = .325f;
-   constexpr float keys_down_time = .04f;
-   constexpr float tile_scale = .5f;
+   constexpr float max_tile_scale = .5f;
+   constexpr float max_screen_fraction = .9f;
+   constexpr int max_preview_rows = 2;
    constexpr float fade_in_time = .5f;
    constexpr float fade_out_time = .5f;
+   constexpr float autosave_interval = 5.f;
+   constexpr int max_ticks_per_frame = 4;
+   constexpr int quick_save_key = KEY_F5, quick_load_key = KEY_F9, hint_key = KEY_H;
+   constexpr int hint_max_pieces = 10;
+   constexpr float hint_time_budget = 1.f / 120.f;
 }
 
 // Constructor
 
-GameState::GameState(const Vector2& grid, int player_count, bool versus)
-   : grid(grid), player_count(player_count), versus(versus) {
+GameState::GameState(const Simulation& simulation)
+   : sim(simulation), grid(simulation.grid), player_count(simulation.player_count), versus(simulation.versus) {
+   sim.telemetry = is_recording_telemetry();
    tile_tx = LoadTexture("assets/tile.png");
-   tile = {tile_tx.width * tile_scale, tile_tx.height * tile_scale};
-
-   for (int i = 0; i < versus + 1; ++i) {
-      std::vector<std::vector<Tile>> tile_map;
-      for (int y = 0; y < grid.y; ++y) {
-         std::vector<Tile> row;
-         for (int x = 0; x < grid.x; ++x) {
-            if (y == 0 or y == grid.y - 1 or x == 0 or x == grid.x - 1) {
-               Tile tile {Tile::border, GRAY};
-               row.push_back(tile);
-            } else {
-               row.push_back({});
-            }
-         }
-         tile_map.push_back(row);
-      }
-      tiles.push_back(tile_map);
-   }
-
-   if (versus) {
-      player_count *= 2;
-   }
 
-   for (int i = 0; i < player_count; ++i) {
-      std::vector<std::vector<Tile>> grid;
-      for (int y = 0; y < next_grid.y; ++y) {
-         std::vector<Tile> row;
-         for (int x = 0; x < next_grid.x; ++x) {
-            if (y == 0 or y == next_grid.y - 1 or x == 0 or x == next_grid.x - 1) {
-               Tile tile {Tile::border, GRAY};
-               row.push_back(tile);
-            } else {
-               row.push_back({});
-            }
-         }
-         grid.push_back(row);
-      }
-      next_tiles.push_back(grid);
-   }
-
-   for (int i = 0; i < player_count; ++i) {
-      Player player;
-      player.id = i;
-      player.tetromino = get_random_tetromino(player);
-      player.color = get_random_color();
-      player.next_tetromino = get_random_tetromino(player);
-      player.next_color = get_random_color();
-      player.key = keybinds[i];
-      draw_next_tetromino(player);
+   // Next pieces are stacked in columns, and tiles shrink when a wide board wouldn't fit on
+   // the monitor
 
-      if (versus) {
-         player.starting_pos = player.pos = {(float)int(int(grid.x - 2) / (player_count / 2 + 1) * (i % (player_count / 2) + 1)), 1};
-      } else {
-         player.starting_pos = player.pos = {(float)int((grid.x - 2) / (player_count + 1) * (i + 1)), 1};
-      }
-      players.push_back(player);
+   preview_columns = (sim.next_tiles.size() + max_preview_rows - 1) / max_preview_rows;
+   float width_in_tiles = grid.x + 1 + preview_columns * (next_grid.x + 1) + (versus ? grid.x : 0);
+   int monitor_width = GetMonitorWidth(GetCurrentMonitor());
+   tile_scale = max_tile_scale;
+   if (monitor_width > 0) {
+      tile_scale = std::min(tile_scale, monitor_width * max_screen_fraction / (tile_tx.width * width_in_tiles));
    }
+   tile = {tile_tx.width * tile_scale, tile_tx.height * tile_scale};
 
    hi_score = read_from_file("save.data"s, {0.f})[0];
    screen_tint = BLACK;
    lost_screen_tint = {0, 0, 0, 0};
 
-   game_height = next_tiles.size() * (next_grid.y + 2);
+   game_height = std::min<int>(sim.next_tiles.size(), max_preview_rows) * (next_grid.y + 2);
    game_width = tile.x * (grid.x + 1);
-   SetWindowSize(tile.x * (grid.x + 8) + (versus ? tile.x * grid.x : 0), std::max(tile.y * grid.y, (game_height + 6) * tile.y));
+   SetWindowSize(tile.x * width_in_tiles, std::max(tile.y * grid.y, (game_height + 6) * tile.y));
 
    music_slider.bg = music_slider.fg = {GetScreenWidth() / 2.f, GetScreenHeight() / 2.f - 20.f, 200.f, 25.f};
    music_slider.knob_radius = 20;
@@ -154,9 +89,51 @@ GameState::GameState(const Vector2& grid, int player_count, bool versus)
    menu_button.text = "MENU";
 }
 
+GameState::GameState(const Vector2& grid, int player_count, bool versus)
+   : GameState(Simulation(grid, player_count, versus, std::random_device{}())) {
+   assign_controllers();
+}
+
+GameState::GameState(const Vector2& grid, const NetConfig& config)
+   : GameState(Simulation(grid, 1, true, config.seed)) {
+   net = std::make_unique<Rollback>();
+
+   if (not net->open(config)) {
+      TraceLog(LOG_WARNING, "NET: Could not open port %i", config.port);
+      phase = Phase::fading_out;
+   }
+}
+
+GameState::GameState(const Vector2& grid, const BotLevel& level)
+   : GameState(grid, 1, true) {
+   cpu_level = level;
+   bots.resize(sim.players.size());
+   bots.back() = std::make_unique<Bot>(level);
+}
+
+GameState::GameState(const Simulation& simulation, std::unique_ptr<Spectator> spectator)
+   : GameState(simulation) {
+   viewer = std::move(spectator);
+}
+
+// Resumes a saved game on its pause screen
+
+GameState::GameState(const Savestate& savestate)
+   : GameState(savestate.sim) {
+   cpu_level = savestate.cpu_level;
+   if (cpu_level) {
+      bots.resize(sim.players.size());
+      bots.back() = std::make_unique<Bot>(*cpu_level);
+   } else {
+      assign_controllers();
+   }
+   phase = Phase::paused;
+   screen_tint.a = 0;
+}
+
 GameState::~GameState() {
-   if (not versus and score >= hi_score) {
-      save_to_file("save.data"s, {float(score)});
+   if (not versus and not viewer and sim.score >= hi_score) {
+      save_to_file("save.data"s, {float(sim.score)});
    }
    save_to_file("settings.data"s, {get_music_volume(), get_sound_volume()});
 }
@@ -203,82 +180,9 @@ void GameState::update_fading_out() {
 // Update game
 
 void GameState::update_game() {
-   for (auto& player : players) {
-      update_key(player.key.down);
-      update_key(player.key.left);
-      update_key(player.key.right);
-
-      if (IsKeyPressed(player.key.rotate)) {
-         rotate(player);
-      }
-
-      if (key_down(player.key.down) and can_move(player.tetromino, player.pos, Path::down, versus and player.id > player_count / 2)) {
-         player.pos.y++;
-         player.down_timer = 0.f;
-         player.soft_drop = true;
-      }
-
-      player.pos.x += (key_down(player.key.right) and can_move(player.tetromino, player.pos, Path::right, versus and player.id > player_count / 2));
-      player.pos.x -= (key_down(player.key.left) and can_move(player.tetromino, player.pos, Path::left, versus and player.id > player_count / 2));
-
-      if (IsKeyPressed(player.key.send)) {
-         while (can_move(player.tetromino, player.pos, Path::down, versus and player.id > player_count / 2)) {
-            player.pos.y++;
-         }
-         player.down_timer = down_after;
-         player.hard_drop = true;
-      }
-
-      player.down_timer += GetFrameTime();
-
-      if (player.down_timer >= down_after) {
-         player.down_timer -= down_after;
-
-         if (can_move(player.tetromino, player.pos, Path::down, versus and player.id > player_count / 2)) {
-            player.pos.y++;
-         } else {
-            draw_tetromino(player);
-            play_audio("place"s);
-
-            clear_cleared_rows(player);
-            player.tetromino = player.next_tetromino;
-            player.color = player.next_color;
-            player.next_tetromino = get_random_tetromino(player);
-            player.next_color = get_random_color();
-            draw_next_tetromino(player);
-
-            player.pos = player.starting_pos;
-            player.down_timer = 0.f;
-
-            if (player.soft_drop or player.hard_drop) {
-               add_drop_score(player, player.hard_drop);
-            }
-            player.soft_drop = player.hard_drop = false;
-
-            if (not can_move(player.tetromino, player.pos, Path::current, versus and player.id > player_count / 2)) {
-               lost = true;
-               left_win = player.id > player_count / 2;
-               play_audio("lost"s);
-               phase = Phase::lost;
-
-               for (auto& p : players) {
-                  p.preview_y = p.pos.y;
-               }
-
-               restart_button.rectangle.x = GetScreenWidth() / 2.f - 92.5f;
-               menu_button.rectangle.x = GetScreenWidth() / 2.f + 92.5f;
-               return;
-            }
-         }
-      }
-      int original = player.pos.y;
-      player.preview_y = player.pos.y;
-
-      while (can_move(player.tetromino, player.pos, Path::down, versus and player.id > player_count / 2)) {
-         player.pos.y = player.preview_y = player.pos.y + 1;
-      }
-      player.pos.y = original;
-   }
+   step_simulation(true);
+   update_savestates();
+   update_hint();
 
    if (IsKeyPressed(KEY_ESCAPE) and phase == Phase::playing) {
       phase = Phase::paused;
@@ -288,6 +192,9 @@ void GameState::update_game() {
 // Update pause screen
 
 void GameState::update_pause_screen() {
+   if (net or viewer) {
+      step_simulation(false);
+   }
    continue_button.update();
    restart_button.update();
    menu_button.update();
@@ -320,6 +227,9 @@ void GameState::update_pause_screen() {
 // Update lost screen
 
 void GameState::update_lost_screen() {
+   if (net or viewer) {
+      step_simulation(false);
+   }
    lost_timer += GetFrameTime();
    lost_screen_tint.a = 255 * lost_timer;
 
@@ -349,38 +259,37 @@ void GameState::render() {
       ClearBackground(BLACK);
 
       for (int i = 0; i < versus + 1; ++i) {
-         for (int y = 0; y < grid.y; ++y) {
-            for (int x = 0; x < grid.x; ++x) {
-               if (tiles[i][y][x].type) {
-                  DrawTextureEx(tile_tx, {i * tile.x * (grid.x + 8) + x * tile.x, y * tile.y}, 0.f, tile_scale, tiles[i][y][x].color);
-               }
-            }
-         }
+         draw_board(i, sim.tiles[i], {i * tile.x * (grid.x + 8), 0});
       }
 
-      for (int i = 0; i < next_tiles.size(); ++i) {
-         DrawText(("NEXT P"s + std::to_string(i + 1) + ": "s).c_str(), game_width, ((next_grid.y + 2) * i + 1) * tile.y, 20, WHITE);
-         for (int y = 0; y < next_grid.y; ++y) {
-            for (int x = 0; x < next_grid.x; ++x) {
-               if (next_tiles[i][y][x].type) {
-                  DrawTextureEx(tile_tx, {(x + grid.x + 1) * tile.x, (next_grid.y + 2) * i * tile.y + (y + 2) * tile.y}, 0.f, tile_scale, next_tiles[i][y][x].color);
-               }
-            }
-         }
+      for (int i = 0; i < sim.garbage.size() and (versus or sim.dig); ++i) {
+         int pending = std::min<int>(sim.garbage[i].size(), grid.y - 2);
+         DrawRectangle(i * tile.x * (grid.x + 8), (grid.y - 1 - pending) * tile.y, tile.x / 3, pending * tile.y, RED);
+      }
+
+      for (int i = 0; i < sim.next_tiles.size(); ++i) {
+         int column = i / max_preview_rows, row = i % max_preview_rows;
+         float left = game_width + column * (next_grid.x + 1) * tile.x;
+
+         DrawText(("NEXT P"s + std::to_string(i + 1) + ": "s).c_str(), left, ((next_grid.y + 2) * row + 1) * tile.y, 20, WHITE);
+         draw_board(sim.tiles.size() + i, sim.next_tiles[i], {left, ((next_grid.y + 2) * row + 2) * tile.y});
       }
 
-      for (const auto& player : players) {
-         int offset_x = (versus and player.id > player_count / 2) * tile.x * (grid.x + 8);
+      for (const auto& player : sim.players) {
+         if (player.waiting) {
+            continue;
+         }
+         int offset_x = player.board * tile.x * (grid.x + 8);
          
          for (int y = player.pos.y; y < player.pos.y + (int)player.tetromino.tiles.size() and y < grid.y; ++y) {
             for (int x = player.pos.x; x < player.pos.x + (int)player.tetromino.tiles.size() and x < grid.x; ++x) {
                if (player.tetromino.tiles[y - player.pos.y][x - player.pos.x]) {
-                  DrawTextureEx(tile_tx, {x * tile.x + offset_x, y * tile.y}, 0.f, tile_scale, player.color);
+                  DrawTextureEx(tile_tx, {x * tile.x + offset_x, y * tile.y}, 0.f, tile_scale, tile_color(player.color));
                }
             }
          }
 
-         if (players.size() > 1) {
+         if (sim.players.size() > 1) {
             DrawText(("P"s + std::to_string(player.id + 1)).c_str(), player.pos.x * tile.x + offset_x, player.pos.y * tile.y, 20, WHITE);
          }
          
@@ -391,18 +300,33 @@ void GameState::render() {
          for (int y = player.preview_y; y < player.preview_y + (int)player.tetromino.tiles.size() and y < grid.y; ++y) {
             for (int x = player.pos.x; x < player.pos.x + (int)player.tetromino.tiles.size() and x < grid.x; ++x) {
                if (player.tetromino.tiles[y - player.preview_y][x - player.pos.x]) {
-                  DrawRectangleLines(x * tile.x + offset_x, y * tile.y, tile.x, tile.y, player.color);
+                  DrawRectangleLines(x * tile.x + offset_x, y * tile.y, tile.x, tile.y, tile_color(player.color));
                }
             }
          }
       }
 
+      if (hint) {
+         for (int y = 0; y < hint->tetromino.tiles.size(); ++y) {
+            for (int x = 0; x < hint->tetromino.tiles.size(); ++x) {
+               if (hint->tetromino.tiles[y][x]) {
+                  DrawRectangleLinesEx({(hint->pos.x + x) * tile.x, (hint->pos.y + y) * tile.y, tile.x, tile.y}, 3.f, WHITE);
+               }
+            }
+         }
+         DrawText(("PERFECT CLEAR IN "s + std::to_string(hint_length)).c_str(), game_width, (game_height + 7) * tile.y, 20, WHITE);
+      }
+
       if (versus) {
-         DrawText(("LEVEL: "s + std::to_string(level)).c_str(), game_width, (game_height + 1) * tile.y, 20, WHITE);
+         DrawText(("LEVEL: "s + std::to_string(sim.level)).c_str(), game_width, (game_height + 1) * tile.y, 20, WHITE);
       } else {
-         DrawText(("SCORE: "s + std::to_string(score)).c_str(), game_width, (game_height + 1) * tile.y, 20, WHITE);
+         DrawText(("SCORE: "s + std::to_string(sim.score)).c_str(), game_width, (game_height + 1) * tile.y, 20, WHITE);
          DrawText(("HI-SCORE: "s + std::to_string(hi_score)).c_str(), game_width, (game_height + 3) * tile.y, 20, WHITE);
-         DrawText(("LEVEL: "s + std::to_string(level)).c_str(), game_width, (game_height + 5) * tile.y, 20, WHITE);
+         DrawText(("LEVEL: "s + std::to_string(sim.level)).c_str(), game_width, (game_height + 5) * tile.y, 20, WHITE);
+      }
+
+      if (sim.dig) {
+         DrawText(("DUG: "s + std::to_string(sim.dug)).c_str(), game_width, (game_height + 9) * tile.y, 20, WHITE);
       }
 
       if (phase == Phase::paused) {
@@ -418,7 +342,7 @@ void GameState::render() {
       } else if (versus and lost) {
          DrawRectangle(0, 0, GetScreenWidth(), GetScreenHeight(), lost_screen_tint);
 
-         std::string won_text = (left_win ? "LEFT SIDE WON"s : "RIGHT SIDE WON"s);
+         std::string won_text = (sim.left_win ? "LEFT SIDE WON"s : "RIGHT SIDE WON"s);
          DrawText("GAME OVER", GetScreenWidth() / 2.f - MeasureText("GAME OVER", 60) / 2.f, GetScreenHeight() / 4.f - 10.f, 60, WHITE);
          DrawText(won_text.c_str(), GetScreenWidth() / 2.f - MeasureText(won_text.c_str(), 40) / 2.f, GetScreenHeight() / 4.f + 75.f, 40, WHITE);
 
@@ -427,7 +351,7 @@ void GameState::render() {
       } else if (lost) {
          DrawRectangle(0, 0, GetScreenWidth(), GetScreenHeight(), lost_screen_tint);
 
-         std::string final_score = "SCORE: "s + std::to_string(score);
+         std::string final_score = "SCORE: "s + std::to_string(sim.score);
          std::string best_score = "HI-SCORE: "s + std::to_string(hi_score);
          DrawText(final_score.c_str(), GetScreenWidth() / 2.f - MeasureText(final_score.c_str(), 30) / 2.f, GetScreenHeight() / 4.f + 50.f, 30, WHITE);
          DrawText(best_score.c_str(), GetScreenWidth() / 2.f - MeasureText(best_score.c_str(), 30) / 2.f, GetScreenHeight() / 4.f + 100.f, 30, WHITE);
@@ -437,280 +361,276 @@ void GameState::render() {
          menu_button.draw();
       }
       DrawRectangle(0, 0, GetScreenWidth(), GetScreenHeight(), screen_tint);
+   capture_frame();
    EndDrawing();
 }
 
-// Change states
+// Draw board, as one quad through the board renderer, or tile by tile without shaders
 
-void GameState::change_state(States& states) {
-   if (restart) {
-      states.push_back(std::make_unique<GameState>(grid, player_count, versus));
-   } else {
-      states.push_back(std::make_unique<MenuState>());
+void GameState::draw_board(int slot, const Board& board, const Vector2& position) {
+   if (board_renderer.ready()) {
+      board_renderer.draw(slot, board, tile_tx, position, tile);
+      return;
    }
-}
 
-// Utility functions
-
-// Draw tetromino
-
-void GameState::draw_tetromino(const Player& player) {
-   for (int y = player.pos.y; y < grid.y and y < player.pos.y + (int)player.tetromino.tiles.size(); ++y) {
-      for (int x = player.pos.x; x < grid.x and x < player.pos.x + (int)player.tetromino.tiles.size(); ++x) {
-         int id = versus and player.id > player_count / 2;
-
-         if (player.tetromino.tiles[y - player.pos.y][x - player.pos.x] and tiles[id][y][x].type != Tile::border) {
-            tiles[id][y][x].type = Tile::on;
-            tiles[id][y][x].color = player.color;
+   for (int y = 0; y < board.height; ++y) {
+      for (int x = 0; x < board.width; ++x) {
+         if (board(x, y)) {
+            DrawTextureEx(tile_tx, {position.x + x * tile.x, position.y + y * tile.y}, 0.f, tile_scale, tile_color(board(x, y)));
          }
       }
    }
 }
 
-// Draw next tetromino
+// Idle, the pause and lost screens of a local game once their fades and buttons settle
 
-void GameState::draw_next_tetromino(const Player& player) {
-   for (int y = 1; y < next_grid.y - 1; ++y) {
-      for (int x = 1; x < next_grid.x - 1; ++x) {
-         next_tiles[player.id][y][x].type = Tile::off;
-      }
+bool GameState::idle() const {
+   if (net or viewer) {
+      return false;
    }
-   int ox = 1 + (player.next_tetromino.tiles.size() != 4);
-   int oy = 1 + (player.next_tetromino.tiles.size() == 2);
 
-   for (int y = oy; y < player.next_tetromino.tiles.size() + oy; ++y) {
-      for (int x = ox; x < player.next_tetromino.tiles.size() + ox; ++x) {
-         if (player.next_tetromino.tiles[y - oy][x - ox]) {
-            next_tiles[player.id][y][x].type = Tile::on;
-            next_tiles[player.id][y][x].color = player.next_color;
-         }
-      }
+   if (phase == Phase::paused) {
+      return continue_button.resting() and restart_button.resting() and menu_button.resting() and not music_slider.dragging and not sfx_slider.dragging;
    }
+   return phase == Phase::lost and lost_timer >= 1.f and restart_button.resting() and menu_button.resting();
 }
 
-// Can move tetromino
+// Change states
 
-bool GameState::can_move(const Tetromino& tetromino, const Vector2& pos, Path type, int id) {
-   for (int y = pos.y; y < grid.y and y < pos.y + (int)tetromino.tiles.size(); ++y) {
-      for (int x = pos.x; x < grid.x and x < pos.x + (int)tetromino.tiles.size(); ++x) {
-         if (not tetromino.tiles[y - pos.y][x - pos.x]) {
-            continue;
-         }
+void GameState::change_state(States& states) {
+   if (local()) {
+      std::remove(suspend_file);
+   }
 
-         if (type == Path::left and (x - 1 < 0 or tiles[id][y][x - 1].type)) {
-            return false;
-         } else if (type == Path::right and (x + 1 >= grid.x or tiles[id][y][x + 1].type)) {
-            return false;
-         } else if (type == Path::down and (y + 1 >= grid.y or tiles[id][y + 1][x].type)) {
-            return false;
-         } else if (type == Path::current and tiles[id][y][x].type) {
-            return false;
-         }
-      }
+   if (restart and cpu_level) {
+      states.push_back(std::make_unique<GameState>(grid, *cpu_level));
+   } else if (restart and sim.dig) {
+      Simulation next(grid, 1, false, std::random_device{}());
+      next.start_dig();
+      states.push_back(std::make_unique<GameState>(next));
+   } else if (restart and not net and not viewer) {
+      states.push_back(std::make_unique<GameState>(grid, player_count, versus));
+   } else {
+      states.push_back(std::make_unique<MenuState>());
    }
-   return true;
 }
 
-// Rotate tetromino
+// Suspend, a local game still being played is saved to be resumed on the next launch
 
-void GameState::rotate(Player& player) {
-   if (player.tetromino.tiles.size() == 2) {
-      return;
+void GameState::suspend() {
+   if (local() and not sim.lost and phase != Phase::fading_out) {
+      write_savestate(suspend_file, make_savestate());
    }
+}
 
-   int rotation = player.tetromino.rotation;
-   Vector2 original_pos = player.pos;
-   const auto& data = (player.tetromino.tiles.size() == 3 ? wall_kick_data_jlstz.at(rotation) : wall_kick_data_i.at(rotation)); 
-
-   for (const auto& offset : data) {
-      player.pos = {original_pos.x + offset.x, original_pos.y + offset.y};
-      Tetromino new_tetromino = player.tetromino;
+// Utility functions
 
-      for (int y = 0; y < player.tetromino.tiles.size(); ++y) {
-         for (int x = 0; x < player.tetromino.tiles.size(); ++x) {
-            new_tetromino.tiles[y][x] = player.tetromino.tiles[player.tetromino.tiles.size() - x - 1][y];
-         }
-      }
+// Assign controllers, co-op players past the keyboard take a free gamepad, or a bot when
+// there is none
 
-      bool can_rotate = can_move(new_tetromino, player.pos, Path::current, versus and player.id > player_count / 2);
-      if (can_rotate) {
-         player.tetromino = new_tetromino;
-         player.tetromino.rotation = (player.tetromino.rotation + 1) % 4;
-         return;
+void GameState::assign_controllers() {
+   for (const auto& player : sim.players) {
+      int gamepad = player.id - keybinds.size();
+      if (gamepad >= 0 and not IsGamepadAvailable(gamepad)) {
+         bots.resize(sim.players.size());
+         bots[player.id] = std::make_unique<Bot>(get_bot_level(1));
       }
    }
-   player.pos = original_pos;
 }
 
-// Clear cleared rows
+// Step simulation, locally or through the rollback session, and pass on the sounds and
+// telemetry it produced. Sounds start straight after the step, before anything is drawn.
 
-void GameState::clear_cleared_rows(const Player& player) {
-   int id = (versus and player.id > player_count / 2);
-   int last_difficult = difficult_count;
-   std::vector<int> cleared, versus_cleared;
+void GameState::step_simulation(bool accept_input) {
+   if (viewer) {
+      if (viewer->player) {
+         viewer->send_input((accept_input ? read_input(keybinds[0]) : Input{}));
+      }
+      viewer->receive(sim);
 
-   for (int y = 1; y < grid.y - 1; ++y) {
-      bool versus_blocks = false;
-      for (int x = 1; x < grid.x - 1; ++x) {
-         if (is_versus_block(tiles[id][y][x].color)) {
-            versus_blocks = true;
-         }
-         if (not tiles[id][y][x].type) {
-            break;
+      if (not viewer->connected and not sim.lost and phase != Phase::fading_out) {
+         phase = Phase::fading_out;
+      }
+   } else if (net) {
+      net->advance(sim, (accept_input ? read_input(keybinds[0]) : Input{}), GetFrameTime());
+   } else {
+      std::vector<Input> inputs;
+      bool pressed = false;
+      for (const auto& player : sim.players) {
+         if (player.id < bots.size() and bots[player.id]) {
+            inputs.push_back(bots[player.id]->update(sim, player, GetFrameTime()));
+            continue;
+         } else if (not accept_input) {
+            inputs.push_back({});
+         } else if (player.id < keybinds.size()) {
+            inputs.push_back(read_input(keybinds[player.id]));
+         } else {
+            inputs.push_back(read_gamepad(player.id - keybinds.size()));
          }
+         pressed |= (inputs.back().held & ~player.previous_input.held) != 0;
+      }
+      note_input(pressed);
 
-         if (x == grid.x - 2) {
-            cleared.push_back(y);
-            if (not versus_blocks) {
-               versus_cleared.push_back(y);
-            }
+      // A checksummed game steps at the fixed tick, like netplay, so a logged tick is the
+      // same amount of game in every run
+
+      if (is_logging_checksums()) {
+         tick_accumulator += GetFrameTime();
+         for (int ticks = 0; tick_accumulator >= tick_time and ticks < max_ticks_per_frame; ++ticks) {
+            sim.step(inputs, tick_time);
+            tick_accumulator -= tick_time;
+            log_checksum(checked_ticks++, checksummer.update(sim));
          }
+         tick_accumulator = std::min(tick_accumulator, tick_time);
+      } else {
+         sim.step(inputs, GetFrameTime());
       }
    }
 
-   if (versus and versus_cleared.size() > 1) {
-      std::stack<std::vector<bool>> cleared_lines;
-      for (const auto& cy : versus_cleared) {
-         std::vector<bool> line;
-         for (int x = 1; x < grid.x - 1; ++x) {
-            int px = x - player.pos.x, py = cy - player.pos.y, sz = player.tetromino.tiles.size();
-            line.push_back(px < 0 or px >= sz or py < 0 or py >= sz or not player.tetromino.tiles[py][px]);
-         }
-         cleared_lines.push(line);
-      }
-      play_audio("send"s);
-      
-      while (not cleared_lines.empty()) {
-         auto line = cleared_lines.top();
-         cleared_lines.pop();
-
-         for (int y = 1; y < grid.y - 1; ++y) {
-            for (int x = 1; x < grid.x - 1; ++x) {
-               if (y < grid.y - 2) {
-                  tiles[not id][y][x] = tiles[not id][y + 1][x];
-               } else {
-                  Tile new_tile {(line[x - 1] ? Tile::on : Tile::off), Color{64, 64, 64, 255}};
-                  tiles[not id][y][x] = new_tile; 
-               }
-            }
-         }
-      }
+   for (const auto& sound : sim.sounds) {
+      play_audio(sound);
    }
+   sim.sounds.clear();
 
-   for (const auto& cy : cleared) {
-      for (int y = cy; y >= 1; --y) {
-         for (int x = 1; x < grid.x - 1; ++x) {
-            if (y == 1) {
-               tiles[id][y][x].type = Tile::off;
-            } else {
-               tiles[id][y][x] = tiles[id][y - 1][x];
-            }
-         }
-      }
+   for (auto event : sim.events) {
+      event.frame_time = GetFrameTime();
+      record_telemetry(event);
    }
-   total_clears += cleared.size();
-   level = std::min(total_clears / rows_for_level_up, 15);
-   down_after = level_speeds[level];
+   sim.events.clear();
 
-   if (versus) {
-      return;
+   if (is_broadcasting() and not viewer) {
+      broadcast_simulation(sim);
    }
 
-   bool perfect = true;
-   for (int y = 1; y < grid.y - 1; ++y) {
-      for (int x = 1; x < grid.x - 1; ++x) {
-         if (tiles[id][y][x].type) {
-            perfect = false;
-            break;
-         }
+   if (sim.lost and phase != Phase::lost and (not net or net->confirmed())) {
+      phase = Phase::lost;
+      lost = true;
+      restart_button.rectangle.x = GetScreenWidth() / 2.f - 92.5f;
+      menu_button.rectangle.x = GetScreenWidth() / 2.f + 92.5f;
+
+      if (local()) {
+         std::remove(suspend_file);
+      }
+      if (not viewer) {
+         record_match(make_match_record());
       }
    }
+}
 
-   if (cleared.empty()) {
-      combo_count = -1;
-   } else {
-      combo_count++;
-      add_score(50 * combo_count);
-      play_audio("combo"s);
-   }
+// Update savestates, autosaves a local game every few seconds so even a crash can be resumed.
+// Games without bots can also be saved to memory and loaded back for practice.
 
-   if (cleared.size() == 1) {
-      add_score((perfect ? 800 : 100));
-   } else if (cleared.size() == 2) {
-      add_score((perfect ? 1200 : 300));
-   } else if (cleared.size() == 3) {
-      add_score((perfect ? 1800 : 500));
-   } else if (cleared.size() == 4) {
-      add_score((perfect ? 2600 : 800));
-      difficult_count++;
+void GameState::update_savestates() {
+   if (not local() or sim.lost) {
+      return;
    }
+   autosave_timer += GetFrameTime();
 
-   if (cleared.size() != 4 and not cleared.empty()) {
-      difficult_count = 0;
+   if (autosave_timer >= autosave_interval) {
+      autosave_timer = 0.f;
+      write_savestate(suspend_file, make_savestate());
    }
 
-   if (difficult_count >= 2 and last_difficult != difficult_count) {
-      play_audio("back_to_back"s);
+   if (not bots.empty()) {
+      return;
    }
-}
 
-// Add drop score
+   if (IsKeyPressed(quick_save_key)) {
+      quick_save = encode_savestate(make_savestate());
+   }
 
-void GameState::add_drop_score(const Player& player, bool hard) {
-   for (int y = 0; y < player.tetromino.tiles.size(); ++y) {
-      for (int x = 0; x < player.tetromino.tiles.size(); ++x) {
-         score += player.tetromino.tiles[y][x] * (hard + 1);
+   if (IsKeyPressed(quick_load_key) and not quick_save.empty()) {
+      if (auto savestate = decode_savestate(quick_save)) {
+         sim = savestate->sim;
+         sim.telemetry = is_recording_telemetry();
+         hint_pieces = -1;
       }
    }
 }
 
-// Add score
+// Update hint, in a single player practice game H toggles showing where the current piece
+// goes for the shortest perfect clear. The search runs once per piece within a frame budget.
 
-void GameState::add_score(int plus) {
-   int level_multiplier = (level == 0 ? 1 : level);
-   score += plus * level_multiplier * (difficult_count >= 2 ? 1.5f : 1.f);
-}
+void GameState::update_hint() {
+   if (not local() or not bots.empty() or sim.players.size() != 1) {
+      return;
+   }
 
-// Get a random tetromino
+   if (IsKeyPressed(hint_key)) {
+      show_hint = not show_hint;
+      hint_pieces = -1;
+      hint.reset();
+   }
+   const Player& player = sim.players[0];
 
-Tetromino GameState::get_random_tetromino(Player& player) {
-   if (player.bag.empty()) {
-      player.bag = tetrominoes;
-      std::random_device rd;
-      std::mt19937 device(rd());
-      std::shuffle(player.bag.begin(), player.bag.end(), device);
+   if (not show_hint or player.pieces == hint_pieces or sim.lost) {
+      return;
    }
-   auto tetromino = player.bag.back();
-   player.bag.pop_back();
-   return tetromino;
-}
+   hint_pieces = player.pieces;
 
-// Get a random color
+   if (not solver_pool) {
+      solver_pool = std::make_unique<ThreadPool>();
+   }
+   auto solution = find_perfect_clear(PlacementBoard(sim.tiles[0]), upcoming_pieces(player), player.starting_pos, hint_max_pieces, hint_time_budget, *solver_pool);
+   hint.reset();
+   hint_length = solution.placements.size();
+   if (hint_length > 0) {
+      hint = solution.placements[0];
+   }
+}
 
-Color GameState::get_random_color() {
-   return colors[rand() % colors.size()];
+Savestate GameState::make_savestate() const {
+   return {sim, (phase == Phase::paused ? Savestate::Phase::paused : Savestate::Phase::playing), cpu_level};
 }
 
-// Is versus color
+// Make match record, pieces per second counts only the players not driven by a bot
+
+MatchRecord GameState::make_match_record() const {
+   MatchRecord record;
+   record.finished = std::time(nullptr);
+   record.seed = sim.seed;
+   record.score = sim.score;
+   record.lines = sim.total_clears;
+   record.level = sim.level;
+   record.duration = sim.time;
+   record.players = sim.players.size();
+   record.grid_width = grid.x;
+   record.grid_height = grid.y;
+   record.mode = (net ? MatchRecord::online : cpu_level ? MatchRecord::cpu : versus ? MatchRecord::versus : sim.dig ? MatchRecord::dig
+      : player_count > 1 ? MatchRecord::co_op : MatchRecord::single);
+
+   int pieces = 0;
+   for (const auto& player : sim.players) {
+      if (player.id >= bots.size() or not bots[player.id]) {
+         pieces += player.pieces;
+      }
+   }
+   record.pieces_per_second = (sim.time > 0.f ? pieces / sim.time : 0.f);
+   return record;
+}
 
-bool GameState::is_versus_block(const Color& color) {
-   return color.r == versus_tile_color.r and color.g == versus_tile_color.g and color.b == versus_tile_color.b;
+bool GameState::local() const {
+   return not net and not viewer;
 }
 
-// Update key
+// Read input
 
-void GameState::update_key(int key) {
-   if (IsKeyDown(key)) {
-      keys_down[key] += GetFrameTime();
-   } else {
-      keys_down[key] = 0;
-   }
+Input GameState::read_input(const Keys& key) {
+   Input input;
+   input.held |= IsKeyDown(key.rotate) * Input::rotate;
+   input.held |= IsKeyDown(key.left) * Input::left;
+   input.held |= IsKeyDown(key.right) * Input::right;
+   input.held |= IsKeyDown(key.down) * Input::down;
+   input.held |= IsKeyDown(key.send) * Input::send;
+   return input;
 }
 
-bool GameState::key_down(int key) {
-   if (keys_down[key] >= keys_down_for_press) {
-      keys_down[key] -= keys_down_time;
-      return true;
-   }
-   return IsKeyPressed(key);
+Input GameState::read_gamepad(int gamepad) {
+   Input input;
+   input.held |= IsGamepadButtonDown(gamepad, gamepad_buttons.rotate) * Input::rotate;
+   input.held |= IsGamepadButtonDown(gamepad, gamepad_buttons.left) * Input::left;
+   input.held |= IsGamepadButtonDown(gamepad, gamepad_buttons.right) * Input::right;
+   input.held |= IsGamepadButtonDown(gamepad, gamepad_buttons.down) * Input::down;
+   input.held |= IsGamepadButtonDown(gamepad, gamepad_buttons.send) * Input::send;
+   return input;
 }
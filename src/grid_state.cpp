@@ -0,0 +1,200 @@
+#include "grid_state.hpp"
+
+// Includes
+
+#include "capture.hpp"
+#include "menu_state.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace std::string_literals;
+
+// Constants
+
+namespace {
+   constexpr Vector2 single_mode_grid {12, 22};
+   constexpr Vector2 screen {1280, 720};
+   constexpr BotLevel watch_level {1e3f, 0.f, 60, 3};
+   constexpr float place_interval = .1f;
+   constexpr float tile_scale = .5f;
+   constexpr int gap = 1;
+}
+
+// Constructor and destructor
+
+GridState::GridState(int count, unsigned int seed, int threads)
+   : pool(threads), rng(seed), grid(single_mode_grid) {
+   SetWindowSize(screen.x, screen.y);
+
+   // Each bot plays with weights spread around the defaults, like a population being tuned
+
+   for (int i = 0; i < count; ++i) {
+      BotGame game;
+      game.sim = Simulation(grid, 1, false, rng());
+      game.weights = spread_weights(rng);
+      games.push_back(std::move(game));
+   }
+
+   // Boards are laid out in the columns and rows that fill the screen best
+
+   float cell_w = grid.x + gap, cell_h = grid.y + gap;
+   columns = std::max(1, (int)std::round(std::sqrt(count * screen.x * cell_h / (screen.y * cell_w))));
+   rows = (count + columns - 1) / columns;
+
+   int width = columns * cell_w, height = rows * cell_h;
+   float scale = std::min(screen.x / width, screen.y / height);
+   view = {(screen.x - width * scale) / 2.f, (screen.y - height * scale) / 2.f, width * scale, height * scale};
+
+   Image image = GenImageColor(width, height, BLACK);
+   texture = LoadTextureFromImage(image);
+   UnloadImage(image);
+   SetTextureFilter(texture, TEXTURE_FILTER_POINT);
+   pixels.assign(width * height, BLACK);
+
+   tile_tx = LoadTexture("assets/tile.png");
+   tile = {tile_tx.width * tile_scale, tile_tx.height * tile_scale};
+}
+
+GridState::~GridState() {
+   UnloadTexture(texture);
+   UnloadTexture(tile_tx);
+}
+
+// Update functions
+
+// Update
+
+void GridState::update() {
+   // At most one piece per frame, so a population too big for the cores slows down instead
+   // of falling further behind
+
+   place_timer += GetFrameTime();
+   if (place_timer >= place_interval) {
+      place_timer = 0;
+      place_pieces();
+   }
+
+   if (IsKeyPressed(KEY_ESCAPE) or IsMouseButtonPressed(MOUSE_BUTTON_RIGHT)) {
+      if (zoomed) {
+         zoomed.reset();
+      } else {
+         quit = true;
+      }
+   }
+
+   if (not zoomed and IsMouseButtonPressed(MOUSE_BUTTON_LEFT) and CheckCollisionPointRec(GetMousePosition(), view)) {
+      float scale = view.width / (columns * (grid.x + gap));
+      int column = (GetMouseX() - view.x) / scale / (grid.x + gap);
+      int row = (GetMouseY() - view.y) / scale / (grid.y + gap);
+      if (row * columns + column < games.size()) {
+         zoomed = row * columns + column;
+      }
+   }
+}
+
+// Place pieces, every bot locks its next piece, spread over the thread pool. Lost games
+// restart with a new seed.
+
+void GridState::place_pieces() {
+   std::vector<unsigned int> seeds (games.size());
+   for (auto& seed : seeds) {
+      seed = rng();
+   }
+
+   for (int i = 0; i < games.size(); ++i) {
+      pool.submit([this, i, seed = seeds[i]] {
+         auto& game = games[i];
+         Input input = place_best(game.sim, game.sim.players[0], game.weights, watch_level, game.table);
+
+         if (input.held) {
+            game.sim.step({input}, tick_time);
+            game.sim.sounds.clear();
+         }
+
+         if (not input.held or game.sim.lost) {
+            game.sim = Simulation(grid, 1, false, seed);
+            game.table.clear();
+         }
+      });
+   }
+   pool.wait();
+}
+
+// Other functions
+
+// Render
+
+void GridState::render() {
+   BeginDrawing();
+      ClearBackground(BLACK);
+      if (zoomed) {
+         render_zoomed(games[*zoomed].sim);
+      } else {
+         render_grid();
+      }
+   capture_frame();
+   EndDrawing();
+}
+
+// Render grid, writes every tile into the image and uploads it in one call
+
+void GridState::render_grid() {
+   int width = columns * (grid.x + gap);
+
+   for (int i = 0; i < games.size(); ++i) {
+      const auto& sim = games[i].sim;
+      Color* origin = pixels.data() + (i / columns) * int(grid.y + gap) * width + (i % columns) * int(grid.x + gap);
+
+      for (int y = 0; y < grid.y; ++y) {
+         const unsigned char* row = sim.tiles[0].row(y);
+         Color* out = origin + y * width;
+         for (int x = 0; x < grid.x; ++x) {
+            out[x] = (row[x] ? tile_color(row[x]) : BLACK);
+         }
+      }
+
+      const Player& player = sim.players[0];
+      for (int y = 0; y < player.tetromino.tiles.size(); ++y) {
+         for (int x = 0; x < player.tetromino.tiles.size(); ++x) {
+            int px = player.pos.x + x, py = player.pos.y + y;
+            if (player.tetromino.tiles[y][x] and px >= 0 and py >= 0 and px < grid.x and py < grid.y) {
+               origin[py * width + px] = tile_color(player.color);
+            }
+         }
+      }
+   }
+
+   UpdateTexture(texture, pixels.data());
+   DrawTexturePro(texture, {0, 0, (float)texture.width, (float)texture.height}, view, {0, 0}, 0.f, WHITE);
+   DrawText(("BOARDS: "s + std::to_string(games.size()) + "  CLICK TO ZOOM"s).c_str(), 10, 10, 20, WHITE);
+}
+
+// Render zoomed, one board with the tile sprite like the game draws it
+
+void GridState::render_zoomed(const Simulation& sim) {
+   Vector2 offset {(GetScreenWidth() - grid.x * tile.x) / 2.f, (GetScreenHeight() - grid.y * tile.y) / 2.f};
+
+   for (int y = 0; y < grid.y; ++y) {
+      for (int x = 0; x < grid.x; ++x) {
+         if (sim.tiles[0](x, y)) {
+            DrawTextureEx(tile_tx, {offset.x + x * tile.x, offset.y + y * tile.y}, 0.f, tile_scale, tile_color(sim.tiles[0](x, y)));
+         }
+      }
+   }
+
+   const Player& player = sim.players[0];
+   for (int y = 0; y < player.tetromino.tiles.size(); ++y) {
+      for (int x = 0; x < player.tetromino.tiles.size(); ++x) {
+         if (player.tetromino.tiles[y][x]) {
+            DrawTextureEx(tile_tx, {offset.x + (player.pos.x + x) * tile.x, offset.y + (player.pos.y + y) * tile.y}, 0.f, tile_scale, tile_color(player.color));
+         }
+      }
+   }
+   DrawText(("BOARD "s + std::to_string(*zoomed + 1) + "  SCORE: "s + std::to_string(sim.score)).c_str(), 10, 10, 20, WHITE);
+}
+
+// Change states
+
+void GridState::change_state(States& states) {
+   states.push_back(std::make_unique<MenuState>());
+}
@@ -0,0 +1,401 @@
+#include "history.hpp"
+
+// Includes
+
+#include "util/bytes.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+// Constants
+
+namespace {
+   constexpr std::uint32_t log_magic = 0x484D5042; // "BPMH"
+   constexpr std::uint32_t index_magic = 0x494D5042; // "BPMI"
+   constexpr std::uint16_t version = 1, index_version = 2;
+   constexpr long header_size = sizeof(log_magic) + sizeof(version) + sizeof(std::uint16_t);
+   constexpr int top_size = 100;
+   constexpr int compact_after = 64;
+   constexpr auto compact_interval = std::chrono::seconds(30);
+   constexpr int read_chunk = 4096;
+   constexpr std::int64_t seconds_per_day = 24 * 60 * 60;
+   constexpr int printed_top = 5, printed_days = 7;
+
+   static_assert(std::is_trivially_copyable_v<MatchRecord>);
+   static_assert(std::is_trivially_copyable_v<DayTotals>);
+
+   // Summary, what the index keeps of one mode. Scores are summed as doubles so the averages
+   // don't overflow over years of games.
+
+   struct TopEntry {
+      std::int32_t score = 0;
+      std::uint32_t record = 0;
+   };
+
+   struct Summary {
+      ModeAverages sums;
+      std::vector<TopEntry> top; // Best first
+      std::map<std::int32_t, DayTotals> days;
+   };
+
+   // Global variables
+
+   std::mutex mutex;
+   std::condition_variable wake;
+   std::thread compactor;
+   std::string log_path, index_path;
+   std::FILE* log = nullptr;
+   std::array<Summary, MatchRecord::modes> summaries;
+   std::uint64_t records = 0, indexed = 0; // Records in the log and in the index file
+   bool running = false;
+
+   std::int32_t day_of(std::int64_t time) {
+      return time / seconds_per_day - (time % seconds_per_day < 0);
+   }
+
+   void add(const MatchRecord& record, std::uint32_t index) {
+      auto& summary = summaries[std::min<int>(record.mode, MatchRecord::modes - 1)];
+      summary.sums.games++;
+      summary.sums.score += record.score;
+      summary.sums.level += record.level;
+      summary.sums.lines += record.lines;
+      summary.sums.duration += record.duration;
+      summary.sums.pieces_per_second += record.pieces_per_second;
+
+      auto& top = summary.top;
+      auto at = std::upper_bound(top.begin(), top.end(), record.score, [](std::int32_t score, const TopEntry& entry) { return score > entry.score; });
+      if (at - top.begin() < top_size) {
+         top.insert(at, {record.score, index});
+         if (top.size() > top_size) {
+            top.pop_back();
+         }
+      }
+
+      auto& day = summary.days[day_of(record.finished)];
+      day.day = day_of(record.finished);
+      day.games++;
+      day.score += record.score;
+   }
+
+   // Index file, the summaries and how many records of the log they cover
+
+   std::vector<unsigned char> encode_index() {
+      ByteWriter writer;
+      writer.write<std::uint32_t>(index_magic);
+      writer.write<std::uint16_t>(index_version);
+      writer.write<std::uint64_t>(records);
+
+      for (const auto& summary : summaries) {
+         writer.write<ModeAverages>(summary.sums);
+         writer.write<std::uint16_t>(summary.top.size());
+         for (const auto& entry : summary.top) {
+            writer.write<TopEntry>(entry);
+         }
+         writer.write<std::uint32_t>(summary.days.size());
+         for (const auto& [_, day] : summary.days) {
+            writer.write<DayTotals>(day);
+         }
+      }
+      return writer.data;
+   }
+
+   bool decode_index(const std::vector<unsigned char>& data) {
+      ByteReader reader(data);
+      if (reader.read<std::uint32_t>() != index_magic or reader.read<std::uint16_t>() != index_version) {
+         return false;
+      }
+      std::uint64_t count = reader.read<std::uint64_t>();
+      if (count > records) {
+         return false;
+      }
+
+      for (auto& summary : summaries) {
+         summary.sums = reader.read<ModeAverages>();
+         int top = reader.read<std::uint16_t>();
+         if (top > top_size) {
+            return false;
+         }
+         for (int i = 0; i < top; ++i) {
+            summary.top.push_back(reader.read<TopEntry>());
+         }
+         std::uint32_t days = reader.read<std::uint32_t>();
+         if (days * sizeof(DayTotals) > reader.size - reader.offset) {
+            return false;
+         }
+         for (std::uint32_t i = 0; i < days; ++i) {
+            auto day = reader.read<DayTotals>();
+            summary.days[day.day] = day;
+         }
+      }
+
+      if (reader.failed or reader.offset != reader.size) {
+         return false;
+      }
+      indexed = count;
+      return true;
+   }
+
+   bool write_index(const std::vector<unsigned char>& data) {
+      std::string temporary = index_path + ".tmp";
+      {
+         std::ofstream f {temporary, std::ios::binary};
+         f.write(reinterpret_cast<const char*>(data.data()), data.size());
+         if (not f) {
+            return false;
+         }
+      }
+      return std::rename(temporary.c_str(), index_path.c_str()) == 0;
+   }
+
+   void load_index() {
+      std::ifstream f {index_path, std::ios::binary};
+      std::vector<unsigned char> data {std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+
+      if (not decode_index(data)) {
+         summaries = {};
+         indexed = 0;
+      }
+   }
+
+   // Catch up, adds the records past the index file in chunks, so rebuilding the index of a
+   // long log never holds it all in memory
+
+   void catch_up() {
+      std::FILE* in = std::fopen(log_path.c_str(), "rb");
+      if (not in) {
+         return;
+      }
+      std::fseek(in, header_size + indexed * sizeof(MatchRecord), SEEK_SET);
+      std::vector<MatchRecord> chunk(read_chunk);
+
+      for (std::uint64_t i = indexed; i < records;) {
+         std::size_t count = std::fread(chunk.data(), sizeof(MatchRecord), std::min<std::uint64_t>(read_chunk, records - i), in);
+         if (count == 0) {
+            break;
+         }
+         for (std::size_t j = 0; j < count; ++j, ++i) {
+            add(chunk[j], i);
+         }
+      }
+      std::fclose(in);
+   }
+
+   // Open log, creates it with a header or checks the header of an existing one, and cuts off
+   // a record left half written by a crash
+
+   bool open_log() {
+      std::error_code error;
+      auto size = std::filesystem::file_size(log_path, error);
+
+      if (error or size < header_size) {
+         std::FILE* out = std::fopen(log_path.c_str(), "wb");
+         if (not out) {
+            return false;
+         }
+         std::uint16_t record_size = sizeof(MatchRecord);
+         std::fwrite(&log_magic, sizeof(log_magic), 1, out);
+         std::fwrite(&version, sizeof(version), 1, out);
+         std::fwrite(&record_size, sizeof(record_size), 1, out);
+         std::fclose(out);
+         size = header_size;
+      } else {
+         std::FILE* in = std::fopen(log_path.c_str(), "rb");
+         std::uint32_t magic = 0;
+         std::uint16_t header_version = 0, record_size = 0;
+         if (in) {
+            std::fread(&magic, sizeof(magic), 1, in);
+            std::fread(&header_version, sizeof(header_version), 1, in);
+            std::fread(&record_size, sizeof(record_size), 1, in);
+            std::fclose(in);
+         }
+         if (magic != log_magic or header_version != version or record_size != sizeof(MatchRecord)) {
+            return false;
+         }
+      }
+
+      records = (size - header_size) / sizeof(MatchRecord);
+      if (header_size + records * sizeof(MatchRecord) != size) {
+         std::filesystem::resize_file(log_path, header_size + records * sizeof(MatchRecord), error);
+      }
+      log = std::fopen(log_path.c_str(), "ab");
+      return log != nullptr;
+   }
+
+   // Compactor, writes the index file once enough records have been appended since the last
+   // write, or some time has passed, and a last time when the history closes
+
+   void run_compactor() {
+      std::unique_lock lock {mutex};
+      bool stop = false;
+
+      while (not stop) {
+         wake.wait_for(lock, compact_interval, [] { return not running or records - indexed >= compact_after; });
+         stop = not running;
+         if (records == indexed) {
+            continue;
+         }
+
+         auto data = encode_index();
+         std::uint64_t count = records;
+         lock.unlock();
+         bool written = write_index(data);
+         lock.lock();
+
+         if (written) {
+            indexed = count;
+         }
+      }
+   }
+
+   const char* mode_name(int mode) {
+      static constexpr const char* names[] {"single", "co-op", "versus", "vs cpu", "online", "dig"};
+      return (mode < std::size(names) ? names[mode] : "unknown");
+   }
+
+   std::string date(std::int64_t time) {
+      std::time_t t = time;
+      char text[16] {};
+      std::strftime(text, sizeof(text), "%Y-%m-%d", std::gmtime(&t));
+      return text;
+   }
+}
+
+// History functions
+
+bool open_history(const std::string& file) {
+   close_history();
+   std::lock_guard lock {mutex};
+   log_path = file;
+   index_path = std::filesystem::path(file).replace_extension(".index").string();
+   summaries = {};
+   records = indexed = 0;
+
+   if (not open_log()) {
+      return false;
+   }
+   load_index();
+   catch_up();
+
+   running = true;
+   compactor = std::thread(run_compactor);
+   return true;
+}
+
+void close_history() {
+   if (not compactor.joinable()) {
+      return;
+   }
+   {
+      std::lock_guard lock {mutex};
+      running = false;
+   }
+   wake.notify_one();
+   compactor.join();
+   std::fclose(log);
+   log = nullptr;
+}
+
+void record_match(const MatchRecord& record) {
+   std::lock_guard lock {mutex};
+   if (not log or std::fwrite(&record, sizeof(record), 1, log) != 1) {
+      return;
+   }
+   std::fflush(log);
+   add(record, records++);
+
+   if (records - indexed >= compact_after) {
+      wake.notify_one();
+   }
+}
+
+// Queries
+
+std::vector<MatchRecord> top_matches(MatchRecord::Mode mode, int count) {
+   std::vector<TopEntry> top;
+   {
+      std::lock_guard lock {mutex};
+      const auto& entries = summaries[mode].top;
+      top.assign(entries.begin(), entries.begin() + std::clamp<int>(count, 0, entries.size()));
+   }
+
+   // Appended records are flushed before they are counted, so the log can be read without
+   // holding the lock
+
+   std::vector<MatchRecord> matches;
+   std::FILE* in = std::fopen(log_path.c_str(), "rb");
+   if (not in) {
+      return matches;
+   }
+   for (const auto& entry : top) {
+      MatchRecord record;
+      std::fseek(in, header_size + long(entry.record) * sizeof(MatchRecord), SEEK_SET);
+      if (std::fread(&record, sizeof(record), 1, in) == 1) {
+         matches.push_back(record);
+      }
+   }
+   std::fclose(in);
+   return matches;
+}
+
+ModeAverages mode_averages(MatchRecord::Mode mode) {
+   std::lock_guard lock {mutex};
+   ModeAverages averages = summaries[mode].sums;
+   if (averages.games > 0) {
+      averages.score /= averages.games;
+      averages.level /= averages.games;
+      averages.lines /= averages.games;
+      averages.duration /= averages.games;
+      averages.pieces_per_second /= averages.games;
+   }
+   return averages;
+}
+
+std::vector<DayTotals> daily_trend(MatchRecord::Mode mode, int days) {
+   std::lock_guard lock {mutex};
+   std::int32_t today = day_of(std::time(nullptr));
+   const auto& totals = summaries[mode].days;
+
+   std::vector<DayTotals> trend;
+   for (auto it = totals.lower_bound(today - days + 1); it != totals.end(); ++it) {
+      trend.push_back(it->second);
+   }
+   return trend;
+}
+
+// Print history
+
+int print_history(const std::string& file, std::FILE* out) {
+   if (not open_history(file)) {
+      std::fprintf(stderr, "Could not open history %s\n", file.c_str());
+      return 1;
+   }
+
+   for (int i = 0; i < MatchRecord::modes; ++i) {
+      auto mode = MatchRecord::Mode(i);
+      auto averages = mode_averages(mode);
+      if (averages.games == 0) {
+         continue;
+      }
+      std::fprintf(out, "%s: %lld games, averaging score %.0f, level %.1f, %.1f lines, %.0fs, %.2f pieces/s\n", mode_name(i),
+         (long long)averages.games, averages.score, averages.level, averages.lines, averages.duration, averages.pieces_per_second);
+
+      for (const auto& match : top_matches(mode, printed_top)) {
+         std::fprintf(out, "  %8d  level %2d  %4d lines  %6.0fs  %.2f pieces/s  %dx%d  seed %u  %s\n", match.score, match.level, match.lines,
+            match.duration, match.pieces_per_second, match.grid_width, match.grid_height, match.seed, date(match.finished).c_str());
+      }
+      for (const auto& day : daily_trend(mode, printed_days)) {
+         std::fprintf(out, "  %s  %3d games  average score %.0f\n", date(day.day * seconds_per_day).c_str(), day.games, day.score / day.games);
+      }
+   }
+   close_history();
+   return 0;
+}
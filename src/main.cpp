@@ -1,10 +1,60 @@
 // Includes
 
+#include "checksum.hpp"
+#include "env_server.hpp"
 #include "game.hpp"
+#include "history.hpp"
+#include "perft.hpp"
+#include "render_bench.hpp"
+#include "solver.hpp"
+#include "telemetry.hpp"
+#include "tournament.hpp"
+#include "tuner.hpp"
 
 // Main function
 
-int main() {
-    Game game;
+int main(int argc, char** argv) {
+    auto options = parse_options(argc, argv);
+    if (options.server) {
+        return run_server(*options.server);
+    }
+
+    if (options.env) {
+        return run_env_server(*options.env);
+    }
+
+    if (options.tuner) {
+        return run_tuner(*options.tuner);
+    }
+
+    if (options.tournament) {
+        return run_tournament(*options.tournament);
+    }
+
+    if (options.desync) {
+        return bisect_checksums(options.desync->first, options.desync->second, stdout);
+    }
+
+    if (options.telemetry_export) {
+        return (export_telemetry_csv(*options.telemetry_export, stdout) ? 0 : 1);
+    }
+
+    if (options.render_bench) {
+        return run_render_bench(*options.render_bench);
+    }
+
+    if (options.show_history) {
+        return print_history(history_file, stdout);
+    }
+
+    if (options.perft_depth > 0) {
+        return run_perft(options.perft_depth, (options.seed ? std::vector{*options.seed} : std::vector{1u, 2u, 3u}));
+    }
+
+    if (options.solve_pieces > 0) {
+        return run_solver(options.solve_pieces, options.savestate_file, (options.seed ? std::vector{*options.seed} : std::vector{1u, 2u, 3u}));
+    }
+
+    Game game(options);
     game.run();
 }
@@ -5,6 +5,11 @@
 #include "util/audio.hpp"
 #include "util/file.hpp"
 #include "game_state.hpp"
+#include "capture.hpp"
+#include "bot.hpp"
+#include "royale_state.hpp"
+#include <random>
+#include <vector>
 
 // Constants
 
@@ -14,7 +19,9 @@ namespace {
    constexpr Vector2 single_mode_grid {12, 22};
    constexpr Vector2 co_op_mode_grid {18, 22};
    constexpr Vector2 screen {636, 700};
+   static const std::vector<std::string> cpu_levels {"EASY", "MEDIUM", "HARD"};
    static bool first_init = true;
+   static int cpu_level = 1;
 }
 
 // Constructors
@@ -25,10 +32,18 @@ MenuState::MenuState() {
    play_button.rectangle = {GetScreenWidth() / 2.f, 250.f, 175.f, 50.f};
    co_op_button.rectangle = {play_button.rectangle.x, play_button.rectangle.y + 75.f, 175.f, 50.f};
    versus_button.rectangle = {co_op_button.rectangle.x, co_op_button.rectangle.y + 75.f, 175.f, 50.f};
-   quit_button.rectangle = {versus_button.rectangle.x, versus_button.rectangle.y + 75.f, 175.f, 50.f};
+   cpu_button.rectangle = {versus_button.rectangle.x, versus_button.rectangle.y + 75.f, 175.f, 50.f};
+   cpu_level_button.rectangle = {cpu_button.rectangle.x + 185.f, cpu_button.rectangle.y, 175.f, 50.f};
+   dig_button.rectangle = {cpu_button.rectangle.x, cpu_button.rectangle.y + 75.f, 175.f, 50.f};
+   royale_button.rectangle = {dig_button.rectangle.x + 185.f, dig_button.rectangle.y, 175.f, 50.f};
+   quit_button.rectangle = {dig_button.rectangle.x, dig_button.rectangle.y + 75.f, 175.f, 50.f};
    play_button.text = "PLAY";
    co_op_button.text = "CO-OP";
    versus_button.text = "VERSUS";
+   cpu_button.text = "VS CPU";
+   cpu_level_button.text = cpu_levels[cpu_level];
+   dig_button.text = "DIG";
+   royale_button.text = "ROYALE";
    quit_button.text = "QUIT";
 
    if (first_init) {
@@ -98,6 +113,10 @@ void MenuState::update_idle_state() {
    play_button.update();
    co_op_button.update();
    versus_button.update();
+   cpu_button.update();
+   cpu_level_button.update();
+   dig_button.update();
+   royale_button.update();
    quit_button.update();
 
    if (play_button.clicked) {
@@ -114,6 +133,26 @@ void MenuState::update_idle_state() {
       play_versus = true;
    }
 
+   if (cpu_button.clicked) {
+      phase = Phase::fading_out;
+      play_cpu = true;
+   }
+
+   if (dig_button.clicked) {
+      phase = Phase::fading_out;
+      play_dig = true;
+   }
+
+   if (royale_button.clicked) {
+      phase = Phase::fading_out;
+      play_royale = true;
+   }
+
+   if (cpu_level_button.clicked) {
+      cpu_level = (cpu_level + 1) % cpu_levels.size();
+      cpu_level_button.text = cpu_levels[cpu_level];
+   }
+
    if (quit_button.clicked) {
       phase = Phase::fading_out;
       quit_for_good = true;
@@ -130,12 +169,25 @@ void MenuState::render() {
       play_button.draw();
       co_op_button.draw();
       versus_button.draw();
+      cpu_button.draw();
+      cpu_level_button.draw();
+      dig_button.draw();
+      royale_button.draw();
       quit_button.draw();
       DrawText("BLOCK PLACER", GetScreenWidth() / 2.f - MeasureText("BLOCK PLACER", 60) / 2.f, 150.f, 60, WHITE);
       DrawRectangle(0, 0, GetScreenWidth(), GetScreenHeight(), screen_tint);
+   capture_frame();
    EndDrawing();
 }
 
+// Idle
+
+bool MenuState::idle() const {
+   return phase == Phase::idle and play_button.resting() and co_op_button.resting() and versus_button.resting() and cpu_button.resting()
+      and cpu_level_button.resting() and dig_button.resting() and royale_button.resting()
+      and quit_button.resting();
+}
+
 // Change states
 
 void MenuState::change_state(States& states) {
@@ -145,6 +197,16 @@ void MenuState::change_state(States& states) {
    
    if (play_co_op) {
       states.push_back(std::make_unique<GameState>(co_op_mode_grid, 2, false));
+   } else if (play_cpu) {
+      states.push_back(std::make_unique<GameState>(single_mode_grid, get_bot_level(cpu_level)));
+   } else if (play_dig) {
+      Simulation sim(single_mode_grid, 1, false, std::random_device{}());
+      sim.start_dig();
+      states.push_back(std::make_unique<GameState>(sim));
+   } else if (play_royale) {
+      RoyaleConfig config;
+      config.seed = std::random_device{}();
+      states.push_back(std::make_unique<RoyaleState>(config));
    } else if (play_versus) {
       states.push_back(std::make_unique<GameState>(single_mode_grid, 1, true));
    } else {
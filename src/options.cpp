@@ -0,0 +1,210 @@
+#include "options.hpp"
+
+// Includes
+
+#include <algorithm>
+#include <string>
+
+using namespace std::string_literals;
+
+// Constants
+
+namespace {
+   constexpr int max_co_op_players = 16;
+   constexpr int min_grid_size = 8, max_grid_size = 255;
+   constexpr int max_royale_humans = 2;
+}
+
+// Parse options
+
+Options parse_options(int argc, char** argv) {
+   Options options;
+   auto net = [&]() -> NetConfig& {
+      if (not options.net) {
+         options.net.emplace();
+      }
+      return *options.net;
+   };
+
+   // A mode's sub-options are kept here and only go to it when its own option selected it, so
+   // one given alone doesn't start the mode
+
+   ServerConfig server;
+   TunerConfig tuner;
+   TournamentConfig tournament;
+   EnvConfig env;
+   CaptureConfig capture;
+   RoyaleConfig royale;
+   RenderBenchConfig render_bench;
+   std::optional<int> max_pieces;
+
+   for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      bool has_value = i + 1 < argc;
+
+      if (arg == "--net"s) {
+         net();
+      } else if (arg == "--port"s and has_value) {
+         net().port = std::stoi(argv[++i]);
+      } else if (arg == "--peer"s and has_value) {
+         std::string peer = argv[++i];
+         auto colon = peer.find(':');
+         net().peer_host = peer.substr(0, colon);
+         if (colon != std::string::npos) {
+            net().peer_port = std::stoi(peer.substr(colon + 1));
+         }
+      } else if (arg == "--side"s and has_value) {
+         net().side = std::stoi(argv[++i]) != 0;
+      } else if (arg == "--seed"s and has_value) {
+         options.seed = std::stoul(argv[++i]);
+      } else if (arg == "--latency"s and has_value) {
+         net().latency = std::stof(argv[++i]) / 1000.f;
+      } else if (arg == "--loss"s and has_value) {
+         net().loss = std::stof(argv[++i]);
+      } else if (arg == "--broadcast"s and has_value) {
+         options.broadcast_port = std::stoi(argv[++i]);
+      } else if ((arg == "--spectate"s or arg == "--connect"s) and has_value) {
+         options.play_online = arg == "--connect"s;
+         std::string host = argv[++i];
+         auto colon = host.find(':');
+         options.spectate.emplace(host.substr(0, colon), (colon != std::string::npos ? std::stoi(host.substr(colon + 1)) : 7500));
+      } else if (arg == "--telemetry"s and has_value) {
+         options.telemetry_file = argv[++i];
+      } else if (arg == "--telemetry-csv"s and has_value) {
+         options.telemetry_export = argv[++i];
+      } else if (arg == "--checksums"s and has_value) {
+         options.checksum_file = argv[++i];
+      } else if (arg == "--desync"s and i + 2 < argc) {
+         options.desync.emplace(argv[i + 1], argv[i + 2]);
+         i += 2;
+      } else if (arg == "--low-latency"s and has_value) {
+         options.low_latency_fps = std::max(std::stoi(argv[++i]), 1);
+      } else if (arg == "--measure-latency"s) {
+         options.measure_latency = true;
+      } else if (arg == "--bench-render"s and has_value) {
+         options.render_bench.emplace();
+         render_bench.frames = std::stoi(argv[++i]);
+      } else if (arg == "--bench-grid"s and has_value) {
+         std::string size = argv[++i];
+         auto x = size.find('x');
+         render_bench.grid.x = std::clamp(std::stoi(size.substr(0, x)), min_grid_size, max_grid_size);
+         if (x != std::string::npos) {
+            render_bench.grid.y = std::clamp(std::stoi(size.substr(x + 1)), min_grid_size, max_grid_size);
+         }
+      } else if (arg == "--capture"s and has_value) {
+         options.capture.emplace();
+         capture.path = argv[++i];
+      } else if (arg == "--capture-queue"s and has_value) {
+         capture.queue_frames = std::max(std::stoi(argv[++i]), 1);
+      } else if (arg == "--capture-policy"s and has_value) {
+         capture.block = argv[++i] == "block"s;
+      } else if (arg == "--dig"s) {
+         options.dig = true;
+      } else if (arg == "--royale"s and has_value) {
+         options.royale.emplace();
+         royale.boards = std::clamp(std::stoi(argv[++i]), 2, max_royale_boards);
+      } else if (arg == "--royale-humans"s and has_value) {
+         royale.humans = std::clamp(std::stoi(argv[++i]), 0, max_royale_humans);
+      } else if (arg == "--history"s) {
+         options.show_history = true;
+      } else if (arg == "--watch"s and has_value) {
+         options.watch_count = std::stoi(argv[++i]);
+      } else if (arg == "--co-op"s and has_value) {
+         options.co_op_players = std::clamp(std::stoi(argv[++i]), 1, max_co_op_players);
+      } else if (arg == "--perft"s and has_value) {
+         options.perft_depth = std::stoi(argv[++i]);
+      } else if (arg == "--solve"s and has_value) {
+         options.solve_pieces = std::stoi(argv[++i]);
+      } else if (arg == "--savestate"s and has_value) {
+         options.savestate_file = argv[++i];
+      } else if (arg == "--server"s and has_value) {
+         options.server.emplace();
+         server.port = std::stoi(argv[++i]);
+      } else if (arg == "--threads"s and has_value) {
+         options.threads = std::stoi(argv[++i]);
+      } else if (arg == "--load"s and has_value) {
+         server.load = std::stoi(argv[++i]);
+      } else if (arg == "--duration"s and has_value) {
+         server.duration = std::stof(argv[++i]);
+      } else if (arg == "--report"s and has_value) {
+         server.report_interval = std::stof(argv[++i]);
+      } else if (arg == "--tune"s and has_value) {
+         options.tuner.emplace();
+         tuner.generations = std::stoi(argv[++i]);
+      } else if (arg == "--population"s and has_value) {
+         tuner.population = std::stoi(argv[++i]);
+      } else if (arg == "--games"s and has_value) {
+         tuner.games = std::stoi(argv[++i]);
+      } else if (arg == "--pieces"s and has_value) {
+         max_pieces = std::stoi(argv[++i]);
+      } else if (arg == "--checkpoint"s and has_value) {
+         tuner.checkpoint = argv[++i];
+      } else if (arg == "--tournament"s and has_value) {
+         options.tournament.emplace();
+         tournament.games = std::max(std::stoi(argv[++i]), 1);
+      } else if (arg == "--entrants"s and has_value) {
+         tournament.entrants = argv[++i];
+      } else if (arg == "--env"s and has_value) {
+         options.env.emplace();
+         env.name = argv[++i];
+      } else if (arg == "--envs"s and has_value) {
+         env.count = std::stoi(argv[++i]);
+      }
+   }
+
+   if (options.net and options.seed) {
+      options.net->seed = *options.seed;
+   }
+   if (options.server) {
+      *options.server = server;
+   }
+   if (options.tuner) {
+      *options.tuner = tuner;
+   }
+   if (options.tournament) {
+      *options.tournament = tournament;
+   }
+   if (options.env) {
+      *options.env = env;
+   }
+   if (options.capture) {
+      *options.capture = capture;
+   }
+   if (options.royale) {
+      *options.royale = royale;
+   }
+   if (options.render_bench) {
+      *options.render_bench = render_bench;
+   }
+   // The piece limit is shared by the tuner and the tournament
+
+   if (options.tuner and max_pieces) {
+      options.tuner->max_pieces = *max_pieces;
+   }
+   if (options.tournament and max_pieces) {
+      options.tournament->max_pieces = *max_pieces;
+   }
+   if (options.tournament and options.seed) {
+      options.tournament->seed = *options.seed;
+   }
+   if (options.tuner and options.seed) {
+      options.tuner->seed = *options.seed;
+   }
+   if (options.env and options.seed) {
+      options.env->seed = *options.seed;
+   }
+   if (options.royale and options.seed) {
+      options.royale->seed = *options.seed;
+   }
+   if (options.render_bench and options.co_op_players > 0) {
+      options.render_bench->co_op_players = options.co_op_players;
+   }
+   // The thread count goes to the mode it runs, the watch grid reads it from the options
+
+   int* threads = (options.tuner ? &options.tuner->threads : options.tournament ? &options.tournament->threads : options.env ? &options.env->threads
+      : options.royale ? &options.royale->threads : options.capture ? &options.capture->threads : options.server ? &options.server->threads : nullptr);
+   if (options.threads and threads) {
+      *threads = *options.threads;
+   }
+   return options;
+}
@@ -0,0 +1,56 @@
+#include "perft.hpp"
+
+// Includes
+
+#include "placement.hpp"
+#include <chrono>
+#include <cstdio>
+
+// Constants
+
+namespace {
+   constexpr Vector2 single_mode_grid {12, 22};
+
+   // Count leaves, every placement of the piece at this depth followed by the next pieces
+
+   long long count_leaves(const PlacementBoard& board, const std::vector<Tetromino>& pieces, const Vector2& spawn, int depth) {
+      auto placements = enumerate_placements(board, pieces[depth], spawn, false);
+      if (depth + 1 == pieces.size()) {
+         return placements.size();
+      }
+
+      long long leaves = 0;
+      for (const auto& placement : placements) {
+         PlacementBoard next = board;
+         next.lock(placement.tetromino, placement.pos);
+         leaves += count_leaves(next, pieces, spawn, depth + 1);
+      }
+      return leaves;
+   }
+}
+
+// Run perft
+
+int run_perft(int depth, const std::vector<unsigned int>& seeds) {
+   for (auto seed : seeds) {
+      Simulation sim(single_mode_grid, 1, false, seed);
+      Player& player = sim.players[0];
+      std::vector<Tetromino> pieces {player.tetromino, player.next_tetromino};
+
+      while (pieces.size() < depth) {
+         pieces.push_back(sim.get_random_tetromino(player));
+      }
+      PlacementBoard board {sim.tiles[0]};
+
+      for (int d = 1; d <= depth; ++d) {
+         std::vector<Tetromino> sequence (pieces.begin(), pieces.begin() + d);
+         auto start = std::chrono::steady_clock::now();
+         long long nodes = count_leaves(board, sequence, player.starting_pos, 0);
+         double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+         std::printf("seed %u depth %d: %lld placements in %.3fs (%.0f nodes/s)\n", seed, d, nodes, seconds, nodes / std::max(seconds, 1e-9));
+         std::fflush(stdout);
+      }
+   }
+   return 0;
+}
@@ -0,0 +1,239 @@
+#include "placement.hpp"
+
+// Includes
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <unordered_set>
+
+// Constants
+
+namespace {
+   constexpr int margin = 4;
+
+   enum class Move : unsigned char { none, left, right, down, rotate };
+
+   // Shape, one rotation of the tetromino with its filled cells listed
+
+   struct Shape {
+      Tetromino tetromino;
+      std::array<std::array<int, 2>, 16> cells;
+      int count = 0;
+   };
+
+   Shape make_shape(const Tetromino& tetromino) {
+      Shape shape;
+      shape.tetromino = tetromino;
+      for (int y = 0; y < tetromino.tiles.size(); ++y) {
+         for (int x = 0; x < tetromino.tiles.size(); ++x) {
+            if (tetromino.tiles[y][x]) {
+               shape.cells[shape.count++] = {x, y};
+            }
+         }
+      }
+      return shape;
+   }
+
+   bool shape_fits(const PlacementBoard& board, const Shape& shape, int px, int py) {
+      for (int i = 0; i < shape.count; ++i) {
+         if (board.occupied(px + shape.cells[i][0], py + shape.cells[i][1])) {
+            return false;
+         }
+      }
+      return true;
+   }
+
+   // Key of the cells a shape covers, so rotations covering the same cells count once
+
+   std::uint64_t cells_key(const PlacementBoard& board, const Shape& shape, int px, int py) {
+      std::array<std::uint64_t, 16> indices;
+      for (int i = 0; i < shape.count; ++i) {
+         indices[i] = (py + shape.cells[i][1]) * board.width + px + shape.cells[i][0];
+      }
+      std::sort(indices.begin(), indices.begin() + shape.count);
+
+      std::uint64_t key = 0;
+      for (int i = 0; i < shape.count; ++i) {
+         key = key * 0x100000001B3ull ^ indices[i];
+      }
+      return key;
+   }
+}
+
+// Placement board
+
+PlacementBoard::PlacementBoard(const Board& board)
+   : width(board.width), height(board.height) {
+   cells.resize(width * height);
+   for (int y = 0; y < height; ++y) {
+      const unsigned char* row = board.row(y);
+      for (int x = 0; x < width; ++x) {
+         cells[y * width + x] = row[x] != Tile::off;
+      }
+   }
+}
+
+bool PlacementBoard::occupied(int x, int y) const {
+   return x < 0 or y < 0 or x >= width or y >= height or cells[y * width + x];
+}
+
+bool PlacementBoard::fits(const Tetromino& tetromino, int px, int py) const {
+   for (int y = 0; y < tetromino.tiles.size(); ++y) {
+      for (int x = 0; x < tetromino.tiles.size(); ++x) {
+         if (tetromino.tiles[y][x] and occupied(px + x, py + y)) {
+            return false;
+         }
+      }
+   }
+   return true;
+}
+
+// Lock, writes the tetromino into the board and clears full rows like the game does
+
+int PlacementBoard::lock(const Tetromino& tetromino, const Vector2& pos) {
+   for (int y = 0; y < tetromino.tiles.size(); ++y) {
+      for (int x = 0; x < tetromino.tiles.size(); ++x) {
+         if (tetromino.tiles[y][x] and not occupied(pos.x + x, pos.y + y)) {
+            cells[(pos.y + y) * width + pos.x + x] = 1;
+         }
+      }
+   }
+
+   int write = height - 2, cleared = 0;
+   for (int y = height - 2; y >= 1; --y) {
+      bool full = true;
+      for (int x = 1; x < width - 1 and full; ++x) {
+         full = cells[y * width + x];
+      }
+
+      if (full) {
+         cleared++;
+         continue;
+      }
+
+      if (write != y) {
+         std::copy_n(cells.begin() + y * width, width, cells.begin() + write * width);
+      }
+      write--;
+   }
+
+   for (int y = write; y >= 1; --y) {
+      std::fill_n(cells.begin() + y * width + 1, width - 2, 0);
+   }
+   return cleared;
+}
+
+bool PlacementBoard::empty() const {
+   for (int y = 1; y < height - 1; ++y) {
+      for (int x = 1; x < width - 1; ++x) {
+         if (cells[y * width + x]) {
+            return false;
+         }
+      }
+   }
+   return true;
+}
+
+// Placement functions
+
+// Enumerate placements, a breadth-first search over position and rotation using the same
+// moves and wall kicks as the game. Each state is visited once, and every state that can't
+// move down is a placement.
+
+std::vector<Placement> enumerate_placements(const PlacementBoard& board, const Tetromino& tetromino, const Vector2& pos, bool with_inputs) {
+   std::vector<Shape> shapes;
+   Tetromino current = tetromino;
+   int rotations = (tetromino.tiles.size() == 2 ? 1 : 4);
+
+   for (int i = 0; i < rotations; ++i) {
+      shapes.push_back(make_shape(current));
+      current = rotated(current);
+   }
+
+   int stride_x = board.width + margin * 2, stride_y = board.height + margin * 2;
+   auto index = [&](int k, int x, int y) { return (k * stride_y + y + margin) * stride_x + x + margin; };
+
+   std::vector<Placement> placements;
+   if (not shape_fits(board, shapes[0], pos.x, pos.y)) {
+      return placements;
+   }
+
+   // Search buffers are reused between calls, a state is visited when its stamp matches
+
+   thread_local std::vector<unsigned int> stamps;
+   thread_local std::vector<int> parent;
+   thread_local std::vector<Move> moves;
+   thread_local std::vector<int> queue;
+   thread_local std::unordered_set<std::uint64_t> finals;
+   thread_local unsigned int stamp = 0;
+
+   size_t states = rotations * stride_x * stride_y;
+   if (stamps.size() < states) {
+      stamps.assign(states, 0);
+      parent.resize(states);
+      moves.resize(states);
+   }
+
+   if (++stamp == 0) {
+      std::fill(stamps.begin(), stamps.end(), 0);
+      stamp = 1;
+   }
+   queue.assign(1, index(0, pos.x, pos.y));
+   finals.clear();
+   stamps[queue[0]] = stamp;
+   parent[queue[0]] = -1;
+
+   auto visit = [&](int from, int k, int x, int y, Move move) {
+      if (x < -margin or y < -margin or x >= board.width + margin or y >= board.height + margin) {
+         return;
+      }
+      int to = index(k, x, y);
+      if (stamps[to] != stamp and shape_fits(board, shapes[k], x, y)) {
+         stamps[to] = stamp;
+         parent[to] = from;
+         moves[to] = move;
+         queue.push_back(to);
+      }
+   };
+
+   for (int head = 0; head < queue.size(); ++head) {
+      int state = queue[head];
+      int k = state / (stride_x * stride_y);
+      int y = state / stride_x % stride_y - margin;
+      int x = state % stride_x - margin;
+
+      visit(state, k, x - 1, y, Move::left);
+      visit(state, k, x + 1, y, Move::right);
+      visit(state, k, x, y + 1, Move::down);
+
+      int next = (k + 1) % rotations;
+      for (const auto& offset : wall_kicks(shapes[k].tetromino)) {
+         if (shape_fits(board, shapes[next], x + offset.x, y + offset.y)) {
+            visit(state, next, x + offset.x, y + offset.y, Move::rotate);
+            break;
+         }
+      }
+
+      if (shape_fits(board, shapes[k], x, y + 1) or not finals.insert(cells_key(board, shapes[k], x, y)).second) {
+         continue;
+      }
+      Placement placement {shapes[k].tetromino, {(float)x, (float)y}, {}};
+
+      if (with_inputs) {
+         for (int at = state; parent[at] >= 0; at = parent[at]) {
+            switch (moves[at]) {
+            case Move::left:   placement.inputs.push_back(Input::left);   break;
+            case Move::right:  placement.inputs.push_back(Input::right);  break;
+            case Move::down:   placement.inputs.push_back(Input::down);   break;
+            case Move::rotate: placement.inputs.push_back(Input::rotate); break;
+            case Move::none:   break;
+            }
+         }
+         std::reverse(placement.inputs.begin(), placement.inputs.end());
+         placement.inputs.push_back(Input::send);
+      }
+      placements.push_back(std::move(placement));
+   }
+   return placements;
+}
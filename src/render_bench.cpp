@@ -0,0 +1,103 @@
+#include "render_bench.hpp"
+
+// Includes
+
+#include "util/audio.hpp"
+#include "util/file.hpp"
+#include "game_state.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// Constants
+
+namespace {
+   using Clock = std::chrono::steady_clock;
+
+   constexpr const char* title = "Block Placer";
+   constexpr Vector2 screen {636, 700};
+   constexpr int warmup_frames = 30;
+   constexpr int open_rows = 6;
+   constexpr int co_op_width_per_player = 4;
+   constexpr int garbage_every = 5;
+
+   // Fill, every row under the open rows is full but for one hole, with garbage mixed into
+   // the colors so all tile kinds are drawn
+
+   void fill(Simulation& sim) {
+      for (auto& board : sim.tiles) {
+         for (int y = open_rows; y < board.height - 1; ++y) {
+            int hole = 1 + y % (board.width - 2);
+            auto row = board.edit_row(y);
+            for (int x = 1; x < board.width - 1; ++x) {
+               row[x] = (x == hole ? (unsigned char)Tile::off : (x + y) % garbage_every == 0 ? (unsigned char)Tile::garbage : sim.get_random_color());
+            }
+         }
+      }
+
+      // Pieces stay at the top with their ghosts resting on the stack
+
+      for (auto& player : sim.players) {
+         player.preview_y = open_rows - player.tetromino.tiles.size();
+      }
+   }
+
+   // Bench, renders a paused game and returns the frame times in milliseconds
+
+   std::vector<float> bench(const Simulation& sim, int frames) {
+      GameState state(Savestate{sim, Savestate::Phase::paused, std::nullopt});
+      std::vector<float> times;
+
+      for (int i = 0; i < warmup_frames + frames; ++i) {
+         auto start = Clock::now();
+         state.render();
+         if (i >= warmup_frames) {
+            times.push_back(std::chrono::duration<float, std::milli>(Clock::now() - start).count());
+         }
+      }
+      return times;
+   }
+
+   void print_times(const char* name, const Vector2& grid, int players, std::vector<float> times) {
+      std::sort(times.begin(), times.end());
+      double total = 0;
+      for (auto time : times) {
+         total += time;
+      }
+      auto at = [&](float q) { return times[std::min<std::size_t>(times.size() * q, times.size() - 1)]; };
+      std::printf("%-7s %3dx%-3d %2d players  p50 %6.3f  p90 %6.3f  p99 %6.3f  max %6.3f ms  %7.1f fps\n", name, int(grid.x), int(grid.y), players,
+         at(.5f), at(.9f), at(.99f), times.back(), times.size() * 1000.0 / total);
+   }
+}
+
+// Run render bench
+
+int run_render_bench(const RenderBenchConfig& config) {
+   InitWindow(screen.x, screen.y, title);
+   SetTargetFPS(0);
+
+   // The game saves the volumes when it is destroyed, so they are read first to leave the
+   // settings as they were
+
+   auto volumes = read_from_file("settings.data", {1.f, 1.f});
+   set_music_volume(volumes[0]);
+   set_sound_volume(volumes[1]);
+
+   int frames = std::max(config.frames, 1);
+   Vector2 co_op_grid {std::max(config.grid.x, float(co_op_width_per_player * config.co_op_players + 2)), config.grid.y};
+
+   Simulation single(config.grid, 1, false, 1);
+   Simulation co_op(co_op_grid, config.co_op_players, false, 1);
+   Simulation versus(config.grid, 1, true, 1);
+   fill(single);
+   fill(co_op);
+   fill(versus);
+
+   print_times("single", config.grid, single.players.size(), bench(single, frames));
+   print_times("co-op", co_op_grid, co_op.players.size(), bench(co_op, frames));
+   print_times("versus", config.grid, versus.players.size(), bench(versus, frames));
+
+   CloseWindow();
+   return 0;
+}
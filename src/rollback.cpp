@@ -0,0 +1,198 @@
+#include "rollback.hpp"
+
+// Includes
+
+#include "util/bytes.hpp"
+#include <algorithm>
+#include <cstdint>
+
+// Constants
+
+namespace {
+   constexpr int max_rollback = 8;
+   constexpr int max_ticks_per_frame = 4;
+   constexpr int max_inputs_per_packet = 64;
+   constexpr std::uint32_t magic = 0x42525042; // "BPRB"
+}
+
+// Open session
+
+bool Rollback::open(const NetConfig& config) {
+   local_id = config.side;
+   remote_id = not config.side;
+   session = config.seed;
+   snapshots.resize(max_rollback + 2);
+
+   if (not socket.open(config.port, config.peer_host, config.peer_port)) {
+      return false;
+   }
+   socket.latency = config.latency;
+   socket.loss = config.loss;
+   return true;
+}
+
+// Advance, runs as many whole ticks as the frame time adds up to, like the royale does, so the
+// game keeps its speed whatever the frame rate. The simulation stalls when the remote player
+// falls further behind than the snapshots can roll back.
+
+void Rollback::advance(Simulation& sim, const Input& local, float dt) {
+   receive();
+
+   if (connected and rollback_tick >= 0 and rollback_tick < tick) {
+      resimulate(sim);
+      rollbacks++;
+   }
+   rollback_tick = -1;
+   log_confirmed(sim);
+
+   sim.sounds.clear();
+   sim.events.clear();
+   accumulator += dt;
+   for (int ticks = 0; accumulator >= tick_time and ticks < max_ticks_per_frame; ++ticks) {
+      if (not connected or tick - remote_tick > max_rollback) {
+         stalls += connected;
+         break;
+      }
+
+      local_inputs.push_back(local);
+      snapshots[tick % snapshots.size()] = sim;
+      sim.step(inputs_at(tick), tick_time);
+      tick++;
+      accumulator -= tick_time;
+      log_confirmed(sim);
+   }
+   accumulator = std::min(accumulator, tick_time);
+   send();
+}
+
+// Confirmed, the current state no longer depends on a prediction
+
+bool Rollback::confirmed() const {
+   return remote_tick >= tick - 1;
+}
+
+int Rollback::get_local_id() const {
+   return local_id;
+}
+
+// Receive, stores remote inputs and marks the earliest tick that was mispredicted. Packets of
+// another session, or with inputs further ahead than the remote can run, are dropped. Inputs
+// older than the snapshots reach are skipped, every one of them has been received already.
+
+void Rollback::receive() {
+   std::vector<unsigned char> data;
+   while (socket.receive(data)) {
+      ByteReader reader {data};
+      std::uint32_t packet_magic = reader.read<std::uint32_t>();
+      std::uint32_t packet_session = reader.read<std::uint32_t>();
+      int first = reader.read<std::int32_t>();
+      int ack = reader.read<std::int32_t>();
+      int count = reader.read<std::uint8_t>();
+
+      int oldest = std::max(0, tick - (int)snapshots.size());
+      if (reader.failed or packet_magic != magic or packet_session != session or first > tick + max_rollback - count + 1) {
+         continue;
+      }
+      connected = true;
+      acked_tick = std::max(acked_tick, std::clamp(ack, -1, tick - 1));
+
+      for (int i = 0; i < count and reader.offset < reader.size; ++i) {
+         int at = first + i;
+         Input input {reader.read<std::uint8_t>()};
+         if (at < oldest) {
+            continue;
+         }
+
+         if (at >= remote_received.size()) {
+            remote_received.resize(at + 1, false);
+            remote_inputs.resize(at + 1);
+         }
+
+         if (remote_received[at]) {
+            continue;
+         }
+
+         if (at < tick and input.held != remote_inputs[at].held and (rollback_tick < 0 or at < rollback_tick)) {
+            rollback_tick = at;
+         }
+         remote_inputs[at] = input;
+         remote_received[at] = true;
+      }
+
+      while (remote_tick + 1 < remote_received.size() and remote_received[remote_tick + 1]) {
+         remote_tick++;
+      }
+   }
+}
+
+// Send, every local input the remote has not acknowledged yet plus our own acknowledgement
+
+void Rollback::send() {
+   int first = std::max(acked_tick + 1, tick - max_inputs_per_packet);
+   int count = tick - first;
+
+   ByteWriter writer;
+   writer.write<std::uint32_t>(magic);
+   writer.write<std::uint32_t>(session);
+   writer.write<std::int32_t>(first);
+   writer.write<std::int32_t>(remote_tick);
+   writer.write<std::uint8_t>(count);
+
+   for (int i = first; i < tick; ++i) {
+      writer.write<std::uint8_t>(local_inputs[i].held);
+   }
+   socket.send(writer.data);
+}
+
+// Resimulate from the first mispredicted tick up to the present
+
+void Rollback::resimulate(Simulation& sim) {
+   sim = snapshots[rollback_tick % snapshots.size()];
+
+   for (int at = rollback_tick; at < tick; ++at) {
+      snapshots[at % snapshots.size()] = sim;
+      sim.step(inputs_at(at), tick_time);
+   }
+   sim.sounds.clear();
+   sim.events.clear();
+}
+
+// Log confirmed, logs the checksum of every tick whose inputs are all known by now. The state
+// after a tick is the snapshot taken before the next one, or the simulation itself for the
+// last tick run, and stalling keeps those snapshots from being overwritten before this.
+
+void Rollback::log_confirmed(const Simulation& sim) {
+   if (not is_logging_checksums()) {
+      return;
+   }
+
+   int last = std::min(remote_tick, tick - 1);
+   while (checked_tick < last) {
+      int at = ++checked_tick;
+      const Simulation& state = (at + 1 < tick ? snapshots[(at + 1) % snapshots.size()] : sim);
+      log_checksum(at, checksummer.update(state));
+   }
+}
+
+// Remote input, the received one or a prediction that repeats the last received one. The
+// prediction is stored so a late input can be compared against what was simulated.
+
+Input Rollback::remote_input(int at) {
+   if (at >= remote_received.size()) {
+      remote_received.resize(at + 1, false);
+      remote_inputs.resize(at + 1);
+   }
+
+   if (not remote_received[at]) {
+      int last = std::min(at - 1, remote_tick);
+      remote_inputs[at] = (last >= 0 ? remote_inputs[last] : Input{});
+   }
+   return remote_inputs[at];
+}
+
+std::vector<Input> Rollback::inputs_at(int at) {
+   std::vector<Input> inputs(2);
+   inputs[local_id] = local_inputs[at];
+   inputs[remote_id] = remote_input(at);
+   return inputs;
+}
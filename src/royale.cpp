@@ -0,0 +1,168 @@
+#include "royale.hpp"
+
+// Includes
+
+#include <algorithm>
+
+// Constants
+
+namespace {
+   constexpr BotLevel royale_level {1e3f, 0.f, 200, 4};
+   constexpr float min_place_interval = .35f, max_place_interval = .9f;
+   constexpr float margin_time = 120.f, margin_interval = 8.f, min_margin_interval = 2.f;
+}
+
+// Constructor, bots get weights spread around the defaults and a pace of their own
+
+Royale::Royale(const Vector2& grid, const RoyaleConfig& config)
+   : pool(config.threads), rng(config.seed) {
+   int count = std::clamp(config.boards, 2, max_royale_boards);
+   std::uniform_real_distribution<float> pace(min_place_interval, max_place_interval);
+
+   for (int i = 0; i < count; ++i) {
+      Contender contender;
+      contender.sim = Simulation(grid, 1, false, rng());
+      contender.sim.royale = true;
+      contender.human = i < config.humans;
+      contender.place_interval = pace(rng);
+      contender.weights = spread_weights(rng);
+      contenders.push_back(std::move(contender));
+   }
+   alive = count;
+}
+
+// Update functions
+
+// Step, each standing board is one task, and the exchange after the tick is the only place
+// boards see each other
+
+void Royale::step(const std::vector<Input>& inputs, float dt) {
+   if (over()) {
+      return;
+   }
+
+   for (int i = 0; i < contenders.size(); ++i) {
+      if (contenders[i].place == 0) {
+         Input input = (contenders[i].human and i < inputs.size() ? inputs[i] : Input{});
+         pool.submit([this, i, input, dt] { update_contender(contenders[i], input, dt); });
+      }
+   }
+   pool.wait();
+   exchange();
+   add_margin_lines(dt);
+   time += dt;
+   ticks++;
+}
+
+// Update contender, takes in the inbox and steps the board. A bot locks its best placement
+// with a hard drop whenever its pace allows.
+
+void Royale::update_contender(Contender& contender, const Input& input, float dt) {
+   auto& sim = contender.sim;
+   sim.garbage[0].insert(sim.garbage[0].end(), contender.inbox.begin(), contender.inbox.end());
+   contender.inbox.clear();
+
+   if (contender.human) {
+      sim.step({input}, dt);
+      return;
+   }
+
+   Input bot_input;
+   Player& player = sim.players[0];
+   contender.place_timer += dt;
+   if (contender.place_timer >= contender.place_interval and not player.waiting) {
+      contender.place_timer -= contender.place_interval;
+      contender.table.clear();
+      bot_input = place_best(sim, player, contender.weights, royale_level, contender.table);
+   }
+   sim.step({bot_input}, dt);
+   sim.sounds.clear();
+}
+
+// Exchange, places the boards that lost this tick, then passes every outbox on in board order.
+// A sender keeps its target until that board is out, so the result only depends on the seed.
+
+void Royale::exchange() {
+   int standing = alive;
+   for (auto& contender : contenders) {
+      if (contender.place == 0 and contender.sim.lost) {
+         contender.place = standing;
+         alive--;
+         if (contender.attacker >= 0) {
+            contenders[contender.attacker].knockouts++;
+         }
+      }
+   }
+
+   if (alive == 1) {
+      for (auto& contender : contenders) {
+         if (contender.place == 0) {
+            contender.place = 1;
+         }
+      }
+   }
+
+   for (int i = 0; i < contenders.size(); ++i) {
+      auto& outbox = contenders[i].sim.outbox;
+      if (outbox.empty()) {
+         continue;
+      }
+
+      int& target = contenders[i].target;
+      if (target < 0 or contenders[target].place != 0) {
+         target = pick_target(i);
+      }
+      if (target >= 0) {
+         auto& inbox = contenders[target].inbox;
+         inbox.insert(inbox.end(), outbox.begin(), outbox.end());
+         contenders[target].attacker = i;
+         contenders[i].sent += outbox.size();
+      }
+      outbox.clear();
+   }
+}
+
+// Add margin lines, one line with a random hole for every standing board, at an interval that
+// shrinks by a second a minute
+
+void Royale::add_margin_lines(float dt) {
+   if (time < margin_time) {
+      return;
+   }
+   margin_timer += dt;
+   float interval = std::max(min_margin_interval, margin_interval - (time - margin_time) / 60.f);
+   if (margin_timer < interval) {
+      return;
+   }
+   margin_timer -= interval;
+
+   int holes = std::min<int>(contenders[0].sim.grid.x - 2, 64);
+   for (auto& contender : contenders) {
+      if (contender.place == 0) {
+         contender.inbox.push_back(std::uint64_t(1) << std::uniform_int_distribution<int>(0, holes - 1)(rng));
+      }
+   }
+}
+
+// Pick target, a random board still standing other than the sender
+
+int Royale::pick_target(int sender) {
+   int others = alive - (contenders[sender].place == 0);
+   if (others <= 0) {
+      return -1;
+   }
+
+   int pick = std::uniform_int_distribution<int>(0, others - 1)(rng);
+   for (int i = 0; i < contenders.size(); ++i) {
+      if (i != sender and contenders[i].place == 0 and pick-- == 0) {
+         return i;
+      }
+   }
+   return -1;
+}
+
+// Utility functions
+
+bool Royale::over() const {
+   return alive <= 1;
+}
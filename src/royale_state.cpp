@@ -0,0 +1,238 @@
+#include "royale_state.hpp"
+
+// Includes
+
+#include "util/audio.hpp"
+#include "capture.hpp"
+#include "game_state.hpp"
+#include "menu_state.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+using namespace std::string_literals;
+
+// Constants
+
+namespace {
+   static const std::vector<Keys> keybinds {
+      {KEY_W, KEY_A, KEY_D, KEY_S, KEY_SPACE},
+      {KEY_UP, KEY_LEFT, KEY_RIGHT, KEY_DOWN, KEY_ENTER}
+   };
+
+   constexpr Vector2 royale_grid {12, 22};
+   constexpr Vector2 screen {1280, 720};
+   constexpr float max_tile_scale = .5f;
+   constexpr float header = 40.f, margin = 10.f;
+   constexpr float lost_fade = .3f;
+   constexpr Color shade {0, 0, 0, 150};
+   constexpr int max_ticks_per_frame = 4;
+   constexpr int gap = 1;
+
+   Input read_keys(const Keys& key) {
+      Input input;
+      input.held |= IsKeyDown(key.rotate) * Input::rotate;
+      input.held |= IsKeyDown(key.left) * Input::left;
+      input.held |= IsKeyDown(key.right) * Input::right;
+      input.held |= IsKeyDown(key.down) * Input::down;
+      input.held |= IsKeyDown(key.send) * Input::send;
+      return input;
+   }
+}
+
+// Constructor and destructor
+
+RoyaleState::RoyaleState(const RoyaleConfig& config)
+   : royale(royale_grid, config), grid(royale_grid) {
+   SetWindowSize(screen.x, screen.y);
+   humans = std::min<int>(std::min<int>(config.humans, keybinds.size()), royale.contenders.size());
+
+   tile_tx = LoadTexture("assets/tile.png");
+   tile_scale = std::min(max_tile_scale, (screen.y - header - margin) / (grid.y * tile_tx.height));
+   tile = {tile_tx.width * tile_scale, tile_tx.height * tile_scale};
+
+   // The overview takes the space right of the human boards, in the columns and rows that
+   // fill it best
+
+   Rectangle area {humans * (grid.x + 1) * tile.x + margin, header, 0, screen.y - header - margin};
+   area.width = screen.x - area.x - margin;
+
+   int count = royale.contenders.size();
+   float cell_w = grid.x + gap, cell_h = grid.y + gap;
+   columns = std::max(1, (int)std::round(std::sqrt(count * area.width * cell_h / (area.height * cell_w))));
+   rows = (count + columns - 1) / columns;
+
+   int width = columns * cell_w, height = rows * cell_h;
+   float scale = std::min(area.width / width, area.height / height);
+   view = {area.x + (area.width - width * scale) / 2.f, area.y + (area.height - height * scale) / 2.f, width * scale, height * scale};
+
+   Image image = GenImageColor(width, height, BLACK);
+   texture = LoadTextureFromImage(image);
+   UnloadImage(image);
+   SetTextureFilter(texture, TEXTURE_FILTER_POINT);
+   pixels.assign(width * height, BLACK);
+}
+
+RoyaleState::~RoyaleState() {
+   UnloadTexture(texture);
+   UnloadTexture(tile_tx);
+}
+
+// Update functions
+
+// Update, the royale steps at the fixed tick so the exchange between boards happens at the
+// same points whatever the frame rate. Input is read once a frame for every tick in it.
+
+void RoyaleState::update() {
+   if (IsKeyPressed(KEY_ESCAPE)) {
+      quit = true;
+   }
+
+   std::vector<Input> inputs;
+   for (int i = 0; i < humans; ++i) {
+      inputs.push_back(read_keys(keybinds[i]));
+   }
+
+   accumulator += GetFrameTime();
+   for (int ticks = 0; accumulator >= tick_time and ticks < max_ticks_per_frame; ++ticks) {
+      auto start = std::chrono::steady_clock::now();
+      royale.step(inputs, tick_time);
+      tick_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+      accumulator -= tick_time;
+   }
+   accumulator = std::min(accumulator, tick_time);
+
+   for (int i = 0; i < humans; ++i) {
+      auto& sim = royale.contenders[i].sim;
+      for (const auto& sound : sim.sounds) {
+         play_audio(sound);
+      }
+      sim.sounds.clear();
+   }
+}
+
+// Other functions
+
+// Render
+
+void RoyaleState::render() {
+   BeginDrawing();
+      ClearBackground(BLACK);
+
+      for (int i = 0; i < humans; ++i) {
+         render_human(i, {i * (grid.x + 1) * tile.x, header});
+      }
+      render_overview();
+
+      char status[96];
+      std::snprintf(status, sizeof(status), "ALIVE: %i/%i  TICK: %.2f MS", royale.alive, (int)royale.contenders.size(), tick_ms);
+      DrawText(status, view.x, margin, 20, WHITE);
+
+      if (royale.over()) {
+         auto winner = std::find_if(royale.contenders.begin(), royale.contenders.end(), [](const auto& c) { return c.place == 1; });
+         int index = winner - royale.contenders.begin();
+         std::string text = (winner == royale.contenders.end() ? "NO WINNER"s : index < humans ? "P"s + std::to_string(index + 1) + " WINS"s
+            : "BOARD "s + std::to_string(index + 1) + " WINS"s);
+
+         DrawRectangle(0, 0, GetScreenWidth(), GetScreenHeight(), shade);
+         DrawText(text.c_str(), GetScreenWidth() / 2.f - MeasureText(text.c_str(), 60) / 2.f, GetScreenHeight() / 3.f, 60, WHITE);
+         DrawText("ESC FOR MENU", GetScreenWidth() / 2.f - MeasureText("ESC FOR MENU", 20) / 2.f, GetScreenHeight() / 3.f + 90.f, 20, WHITE);
+      }
+   capture_frame();
+   EndDrawing();
+}
+
+// Render overview, writes every board's tiles and piece into the image and uploads it in one
+// call. Boards that are out are dimmed, and the boards the humans are sending to are outlined.
+
+void RoyaleState::render_overview() {
+   int width = columns * (grid.x + gap);
+   float scale = view.width / width;
+
+   for (int i = 0; i < royale.contenders.size(); ++i) {
+      const auto& contender = royale.contenders[i];
+      const auto& sim = contender.sim;
+      float fade = (contender.place == 0 or contender.place == 1 ? 1.f : lost_fade);
+      Color* origin = pixels.data() + (i / columns) * int(grid.y + gap) * width + (i % columns) * int(grid.x + gap);
+
+      for (int y = 0; y < grid.y; ++y) {
+         const unsigned char* row = sim.tiles[0].row(y);
+         Color* out = origin + y * width;
+         for (int x = 0; x < grid.x; ++x) {
+            out[x] = (row[x] ? ColorBrightness(tile_color(row[x]), fade - 1.f) : BLACK);
+         }
+      }
+
+      const Player& player = sim.players[0];
+      for (int y = 0; y < player.tetromino.tiles.size() and not player.waiting; ++y) {
+         for (int x = 0; x < player.tetromino.tiles.size(); ++x) {
+            int px = player.pos.x + x, py = player.pos.y + y;
+            if (player.tetromino.tiles[y][x] and px >= 0 and py >= 0 and px < grid.x and py < grid.y) {
+               origin[py * width + px] = ColorBrightness(tile_color(player.color), fade - 1.f);
+            }
+         }
+      }
+   }
+
+   UpdateTexture(texture, pixels.data());
+   DrawTexturePro(texture, {0, 0, (float)texture.width, (float)texture.height}, view, {0, 0}, 0.f, WHITE);
+
+   for (int i = 0; i < humans; ++i) {
+      int target = royale.contenders[i].target;
+      if (target >= 0 and royale.contenders[i].place == 0) {
+         Rectangle cell {view.x + (target % columns) * (grid.x + gap) * scale, view.y + (target / columns) * (grid.y + gap) * scale, grid.x * scale, grid.y * scale};
+         DrawRectangleLinesEx(cell, 2.f, (i == 0 ? RED : SKYBLUE));
+      }
+   }
+}
+
+// Render human, one human's board at full size with the piece, its ghost and the lines
+// waiting to rise
+
+void RoyaleState::render_human(int index, const Vector2& position) {
+   const auto& contender = royale.contenders[index];
+   const auto& sim = contender.sim;
+   const Board& board = sim.tiles[0];
+
+   if (board_renderer.ready()) {
+      board_renderer.draw(index, board, tile_tx, position, tile);
+   } else {
+      for (int y = 0; y < board.height; ++y) {
+         for (int x = 0; x < board.width; ++x) {
+            if (board(x, y)) {
+               DrawTextureEx(tile_tx, {position.x + x * tile.x, position.y + y * tile.y}, 0.f, tile_scale, tile_color(board(x, y)));
+            }
+         }
+      }
+   }
+
+   const Player& player = sim.players[0];
+   for (int y = 0; y < player.tetromino.tiles.size() and not player.waiting; ++y) {
+      for (int x = 0; x < player.tetromino.tiles.size(); ++x) {
+         if (player.tetromino.tiles[y][x]) {
+            Vector2 at {position.x + (player.pos.x + x) * tile.x, position.y + (player.pos.y + y) * tile.y};
+            DrawTextureEx(tile_tx, at, 0.f, tile_scale, tile_color(player.color));
+            DrawRectangleLines(at.x, position.y + (player.preview_y + y) * tile.y, tile.x, tile.y, tile_color(player.color));
+         }
+      }
+   }
+
+   int pending = std::min<int>(sim.garbage[0].size() + contender.inbox.size(), grid.y - 2);
+   DrawRectangle(position.x, position.y + (grid.y - 1 - pending) * tile.y, tile.x / 3, pending * tile.y, RED);
+
+   std::string stats = "P"s + std::to_string(index + 1) + "  KO: "s + std::to_string(contender.knockouts) + "  SENT: "s + std::to_string(contender.sent);
+   DrawText(stats.c_str(), position.x, margin, 20, WHITE);
+
+   if (contender.place != 0 and not royale.over()) {
+      std::string place = "#"s + std::to_string(contender.place);
+      DrawRectangle(position.x, position.y, grid.x * tile.x, grid.y * tile.y, shade);
+      DrawText(place.c_str(), position.x + grid.x * tile.x / 2.f - MeasureText(place.c_str(), 60) / 2.f, position.y + grid.y * tile.y / 3.f, 60, WHITE);
+   }
+}
+
+// Change states
+
+void RoyaleState::change_state(States& states) {
+   states.push_back(std::make_unique<MenuState>());
+}
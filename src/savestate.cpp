@@ -0,0 +1,330 @@
+#include "savestate.hpp"
+
+// Includes
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <type_traits>
+
+// Constants
+
+namespace {
+   constexpr std::uint32_t magic = 0x53535042; // "BPSS"
+   constexpr std::uint16_t version = 3;
+   constexpr int max_boards = 64, max_bag = 64, max_garbage = 1024;
+   constexpr int next_size = 6, max_level = 15;
+
+   // The generator is written as its raw state, which is a few kilobytes of words instead of
+   // the tens of kilobytes of text its stream operators produce
+
+   static_assert(std::is_trivially_copyable_v<std::mt19937>);
+
+   // Tetrominoes, a size, one bit per cell and the rotation
+
+   void write_tetromino(ByteWriter& writer, const Tetromino& tetromino) {
+      int size = tetromino.tiles.size();
+      std::uint16_t mask = 0;
+      for (int y = 0; y < size; ++y) {
+         for (int x = 0; x < size; ++x) {
+            mask |= tetromino.tiles[y][x] << (y * size + x);
+         }
+      }
+      writer.write<std::uint8_t>(size);
+      writer.write<std::uint16_t>(mask);
+      writer.write<std::uint8_t>(tetromino.rotation);
+   }
+
+   Tetromino read_tetromino(ByteReader& reader) {
+      Tetromino tetromino;
+      int size = std::min<int>(reader.read<std::uint8_t>(), 4);
+      std::uint16_t mask = reader.read<std::uint16_t>();
+
+      tetromino.tiles.assign(size, std::vector<bool>(size));
+      for (int y = 0; y < size; ++y) {
+         for (int x = 0; x < size; ++x) {
+            tetromino.tiles[y][x] = mask >> (y * size + x) & 1;
+         }
+      }
+      tetromino.rotation = reader.read<std::uint8_t>() % 4;
+      return tetromino;
+   }
+
+   // Within grid, the piece's box at pos overlaps the grid and starts no higher than the top
+   // row, as it does wherever the game puts it
+
+   bool within_grid(const Vector2& pos, const Tetromino& tetromino, const Vector2& grid) {
+      int size = tetromino.tiles.size();
+      return pos.x > -size and pos.y >= 0 and pos.x < grid.x and pos.y < grid.y;
+   }
+
+   // Boards, their size and then every row
+
+   void write_boards(ByteWriter& writer, const std::vector<Board>& boards) {
+      writer.write<std::uint8_t>(boards.size());
+      for (const auto& board : boards) {
+         writer.write<std::uint8_t>(board.width);
+         writer.write<std::uint8_t>(board.height);
+         for (int y = 0; y < board.height; ++y) {
+            writer.data.insert(writer.data.end(), board.row(y), board.row(y) + board.width);
+         }
+      }
+   }
+
+   bool read_boards(ByteReader& reader, std::vector<Board>& boards) {
+      int count = reader.read<std::uint8_t>();
+      if (count > max_boards) {
+         return false;
+      }
+      boards.clear();
+
+      for (int i = 0; i < count and not reader.failed; ++i) {
+         int width = reader.read<std::uint8_t>(), height = reader.read<std::uint8_t>();
+         if (reader.offset + width * height > reader.size) {
+            return false;
+         }
+         Board board(width, height);
+         for (int y = 0; y < height; ++y) {
+            std::copy_n(reader.data + reader.offset + y * width, width, board.edit_row(y));
+         }
+         reader.offset += width * height;
+         boards.push_back(std::move(board));
+      }
+      return not reader.failed;
+   }
+}
+
+// Encoding functions
+
+std::vector<unsigned char> encode_savestate(const Savestate& state) {
+   const Simulation& sim = state.sim;
+   ByteWriter writer;
+   writer.data.reserve(sizeof(std::mt19937) + 1024 + sim.tiles.size() * sim.grid.x * sim.grid.y * 2);
+
+   writer.write<std::uint32_t>(magic);
+   writer.write<std::uint16_t>(version);
+   writer.write<std::uint8_t>(std::uint8_t(state.phase));
+   writer.write<std::uint8_t>(state.cpu_level.has_value());
+   writer.write<BotLevel>(state.cpu_level.value_or(BotLevel{}));
+
+   writer.write<std::uint8_t>(sim.grid.x);
+   writer.write<std::uint8_t>(sim.grid.y);
+   writer.write<std::uint8_t>(sim.player_count);
+   writer.write<std::uint8_t>(sim.versus | sim.lost << 1 | sim.left_win << 2 | sim.dig << 3);
+   writer.write<std::int32_t>(sim.score);
+   writer.write<std::int32_t>(sim.total_clears);
+   writer.write<std::int32_t>(sim.combo_count);
+   writer.write<std::int32_t>(sim.difficult_count);
+   writer.write<std::int32_t>(sim.level);
+   writer.write<std::uint32_t>(sim.seed);
+   writer.write<float>(sim.down_after);
+   writer.write<float>(sim.time);
+   writer.write<std::uint64_t>(sim.dig_rows);
+   writer.write<std::uint8_t>(sim.dig_hole);
+   writer.write<std::int32_t>(sim.dug);
+   writer.write<float>(sim.rise_timer);
+   writer.write<std::mt19937>(sim.rng);
+
+   write_boards(writer, sim.tiles);
+   write_boards(writer, sim.next_tiles);
+
+   for (const auto& lines : sim.garbage) {
+      writer.write<std::uint16_t>(lines.size());
+      for (auto line : lines) {
+         writer.write<std::uint64_t>(line);
+      }
+   }
+
+   writer.write<std::uint8_t>(not sim.active.empty());
+   for (const auto& cells : sim.active) {
+      writer.data.insert(writer.data.end(), cells.begin(), cells.end());
+   }
+
+   writer.write<std::uint8_t>(sim.players.size());
+   for (const auto& player : sim.players) {
+      writer.write<std::uint8_t>(player.bag.size());
+      for (const auto& tetromino : player.bag) {
+         write_tetromino(writer, tetromino);
+      }
+      write_tetromino(writer, player.tetromino);
+      write_tetromino(writer, player.next_tetromino);
+
+      writer.write<std::uint8_t>(player.color);
+      writer.write<std::uint8_t>(player.next_color);
+      writer.write<std::int8_t>(player.pos.x);
+      writer.write<std::int8_t>(player.pos.y);
+      writer.write<std::int8_t>(player.starting_pos.x);
+      writer.write<std::int8_t>(player.starting_pos.y);
+      writer.write<std::uint8_t>(player.previous_input.held);
+      writer.write<std::int8_t>(player.preview_y);
+      writer.write<std::uint8_t>(player.board);
+      writer.write<std::int32_t>(player.pieces);
+      writer.write<std::uint8_t>(player.soft_drop | player.hard_drop << 1 | player.waiting << 2);
+      writer.write<float>(player.down_timer);
+      writer.write<float>(player.left_timer);
+      writer.write<float>(player.right_timer);
+      writer.write<float>(player.soft_drop_timer);
+   }
+   return writer.data;
+}
+
+std::optional<Savestate> decode_savestate(const std::vector<unsigned char>& data) {
+   ByteReader reader(data);
+   if (reader.read<std::uint32_t>() != magic or reader.read<std::uint16_t>() != version) {
+      return std::nullopt;
+   }
+
+   Savestate state;
+   Simulation& sim = state.sim;
+   state.phase = Savestate::Phase(reader.read<std::uint8_t>() & 1);
+   bool has_cpu = reader.read<std::uint8_t>();
+   auto cpu_level = reader.read<BotLevel>();
+   if (has_cpu) {
+      state.cpu_level = cpu_level;
+   }
+
+   sim.grid.x = reader.read<std::uint8_t>();
+   sim.grid.y = reader.read<std::uint8_t>();
+   sim.player_count = reader.read<std::uint8_t>();
+   int flags = reader.read<std::uint8_t>();
+   sim.versus = flags & 1;
+   sim.lost = flags & 2;
+   sim.left_win = flags & 4;
+   sim.dig = flags & 8;
+   sim.score = reader.read<std::int32_t>();
+   sim.total_clears = reader.read<std::int32_t>();
+   sim.combo_count = reader.read<std::int32_t>();
+   sim.difficult_count = reader.read<std::int32_t>();
+   sim.level = reader.read<std::int32_t>();
+   sim.seed = reader.read<std::uint32_t>();
+   sim.down_after = reader.read<float>();
+   sim.time = reader.read<float>();
+   sim.dig_rows = reader.read<std::uint64_t>();
+   sim.dig_hole = std::min<int>(reader.read<std::uint8_t>(), 63);
+   sim.dug = reader.read<std::int32_t>();
+   sim.rise_timer = reader.read<float>();
+   sim.rng = reader.read<std::mt19937>();
+
+   // The level indexes the speed table, and versus exchanges garbage between exactly two boards
+
+   if (sim.level < 0 or sim.level > max_level or sim.total_clears < 0) {
+      return std::nullopt;
+   }
+   if (not read_boards(reader, sim.tiles) or not read_boards(reader, sim.next_tiles) or sim.tiles.size() != sim.versus + 1) {
+      return std::nullopt;
+   }
+
+   for (const auto& board : sim.tiles) {
+      if (board.width != sim.grid.x or board.height != sim.grid.y) {
+         return std::nullopt;
+      }
+   }
+   for (const auto& board : sim.next_tiles) {
+      if (board.width != next_size or board.height != next_size) {
+         return std::nullopt;
+      }
+   }
+
+   sim.garbage.resize(sim.tiles.size());
+   for (auto& lines : sim.garbage) {
+      int count = reader.read<std::uint16_t>();
+      if (count > max_garbage) {
+         return std::nullopt;
+      }
+      for (int i = 0; i < count; ++i) {
+         lines.push_back(reader.read<std::uint64_t>());
+      }
+   }
+
+   if (reader.read<std::uint8_t>()) {
+      size_t cells = sim.grid.x * sim.grid.y;
+      if (reader.offset + cells * sim.tiles.size() > reader.size) {
+         return std::nullopt;
+      }
+      sim.active.resize(sim.tiles.size());
+      for (auto& active : sim.active) {
+         active.assign(reader.data + reader.offset, reader.data + reader.offset + cells);
+         reader.offset += cells;
+      }
+   }
+
+   // A versus game has a player per side for every player counted
+
+   int player_count = reader.read<std::uint8_t>();
+   if (player_count != sim.next_tiles.size() or player_count != sim.player_count * (sim.versus ? 2 : 1)) {
+      return std::nullopt;
+   }
+
+   for (int i = 0; i < player_count and not reader.failed; ++i) {
+      Player player;
+      player.id = i;
+
+      int bag_size = reader.read<std::uint8_t>();
+      if (bag_size > max_bag) {
+         return std::nullopt;
+      }
+      for (int j = 0; j < bag_size; ++j) {
+         player.bag.push_back(read_tetromino(reader));
+      }
+      player.tetromino = read_tetromino(reader);
+      player.next_tetromino = read_tetromino(reader);
+
+      player.color = reader.read<std::uint8_t>();
+      player.next_color = reader.read<std::uint8_t>();
+      player.pos.x = reader.read<std::int8_t>();
+      player.pos.y = reader.read<std::int8_t>();
+      player.starting_pos.x = reader.read<std::int8_t>();
+      player.starting_pos.y = reader.read<std::int8_t>();
+      player.previous_input.held = reader.read<std::uint8_t>();
+      player.preview_y = reader.read<std::int8_t>();
+      player.board = reader.read<std::uint8_t>();
+      player.pieces = reader.read<std::int32_t>();
+      int player_flags = reader.read<std::uint8_t>();
+      player.soft_drop = player_flags & 1;
+      player.hard_drop = player_flags & 2;
+      player.waiting = player_flags & 4;
+      player.down_timer = reader.read<float>();
+      player.left_timer = reader.read<float>();
+      player.right_timer = reader.read<float>();
+      player.soft_drop_timer = reader.read<float>();
+
+      if (player.board >= sim.tiles.size() or player.tetromino.tiles.empty() or player.next_tetromino.tiles.empty()) {
+         return std::nullopt;
+      }
+      if (not within_grid(player.pos, player.tetromino, sim.grid) or not within_grid(player.starting_pos, player.tetromino, sim.grid)) {
+         return std::nullopt;
+      }
+      sim.players.push_back(std::move(player));
+   }
+
+   if (reader.failed or reader.offset != reader.size) {
+      return std::nullopt;
+   }
+   return state;
+}
+
+// File functions
+
+bool write_savestate(const std::string& file, const Savestate& state) {
+   auto data = encode_savestate(state);
+   std::string temporary = file + ".tmp";
+   {
+      std::ofstream f {temporary, std::ios::binary};
+      f.write(reinterpret_cast<const char*>(data.data()), data.size());
+      if (not f) {
+         return false;
+      }
+   }
+   return std::rename(temporary.c_str(), file.c_str()) == 0;
+}
+
+std::optional<Savestate> read_savestate(const std::string& file) {
+   std::ifstream f {file, std::ios::binary};
+   if (not f) {
+      return std::nullopt;
+   }
+   std::vector<unsigned char> data {std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+   return decode_savestate(data);
+}
@@ -0,0 +1,379 @@
+#include "server.hpp"
+
+// Includes
+
+#include "util/connection.hpp"
+#include "broadcast.hpp"
+#include "simulation.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+
+// Constants
+
+namespace {
+   using Clock = std::chrono::steady_clock;
+
+   constexpr Vector2 versus_grid {12, 22};
+   constexpr int max_pending_bytes = 1 << 16;
+   constexpr int max_events = 256;
+
+   // Match
+
+   struct Match {
+      Simulation sim;
+      std::array<Connection, 2> clients;
+      std::vector<Input> inputs = std::vector<Input>(2);
+      std::optional<BroadcastFrame> previous;
+      std::mt19937 bot_rng;
+      bool synthetic = false;
+   };
+
+   // Worker, owns its matches and their sockets so ticking never takes a lock
+
+   struct Worker {
+      std::thread thread;
+      std::vector<std::unique_ptr<Match>> matches;
+      std::unordered_map<int, std::pair<Match*, int>> clients;
+      int epoll_fd = -1, wake_fd = -1, cpu = 0;
+
+      std::mutex incoming_mutex;
+      std::vector<std::array<int, 2>> incoming;
+      std::atomic<int> match_count = 0;
+
+      std::mutex stats_mutex;
+      std::vector<float> tick_times;
+      double busy_time = 0;
+      int overruns = 0;
+   };
+
+   std::atomic<bool> running = false;
+   std::atomic<unsigned int> next_seed = 1;
+
+   // Start match, a pair of -1 sockets is a synthetic match driven by random inputs
+
+   void start_match(Worker& worker, const std::array<int, 2>& fds) {
+      auto match = std::make_unique<Match>();
+      unsigned int seed = next_seed++;
+      match->sim = Simulation(versus_grid, 1, true, seed);
+      match->bot_rng.seed(seed);
+      match->synthetic = fds[0] < 0;
+
+      for (int side = 0; side < 2 and not match->synthetic; ++side) {
+         match->clients[side].fd = fds[side];
+         epoll_event event {};
+         event.events = EPOLLIN;
+         event.data.fd = fds[side];
+         epoll_ctl(worker.epoll_fd, EPOLL_CTL_ADD, fds[side], &event);
+         worker.clients[fds[side]] = {match.get(), side};
+      }
+      worker.matches.push_back(std::move(match));
+   }
+
+   void drop_client(Worker& worker, Connection& client) {
+      if (client.fd < 0) {
+         return;
+      }
+      epoll_ctl(worker.epoll_fd, EPOLL_CTL_DEL, client.fd, nullptr);
+      worker.clients.erase(client.fd);
+      close_connection(client);
+   }
+
+   // Read inputs, only the latest held byte matters
+
+   void read_client(Worker& worker, int fd) {
+      auto it = worker.clients.find(fd);
+      if (it == worker.clients.end()) {
+         return;
+      }
+      auto [match, side] = it->second;
+
+      unsigned char data[64];
+      while (true) {
+         ssize_t size = recv(fd, data, sizeof(data), MSG_DONTWAIT);
+         if (size > 0) {
+            match->inputs[side].held = data[size - 1];
+         } else if (size == 0 or (errno != EAGAIN and errno != EWOULDBLOCK)) {
+            match->inputs[side] = {};
+            drop_client(worker, match->clients[side]);
+            return;
+         } else {
+            return;
+         }
+      }
+   }
+
+   // Tick match, steps the rules and sends the frame to both clients
+
+   void tick_match(Worker& worker, Match& match) {
+      if (match.synthetic) {
+         for (auto& input : match.inputs) {
+            if (match.bot_rng() % 8 == 0) {
+               input.held = match.bot_rng() % 32;
+            }
+         }
+      }
+      match.sim.step(match.inputs, tick_time);
+      match.sim.sounds.clear();
+
+      if (match.synthetic) {
+         return;
+      }
+      auto frame = make_broadcast_frame(match.sim);
+      std::vector<unsigned char> delta, keyframe;
+      if (match.previous) {
+         delta = encode_broadcast_frame(frame, &*match.previous);
+      }
+
+      for (auto& client : match.clients) {
+         if (client.fd < 0) {
+            continue;
+         }
+
+         if (not client.pending.empty()) {
+            client.needs_keyframe = true;
+         } else if (client.needs_keyframe or not match.previous) {
+            if (keyframe.empty()) {
+               keyframe = encode_broadcast_frame(frame, nullptr);
+            }
+            queue_message(client, keyframe);
+            client.needs_keyframe = false;
+         } else {
+            queue_message(client, delta);
+         }
+
+         if (not flush_connection(client) or client.pending.size() > max_pending_bytes) {
+            drop_client(worker, client);
+         }
+      }
+      match.previous = std::move(frame);
+   }
+
+   // Run worker
+
+   void run_worker(Worker& worker) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(worker.cpu, &set);
+      pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+      const auto tick = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(tick_time));
+      auto next_tick = Clock::now() + tick;
+      epoll_event events[max_events];
+
+      while (running) {
+         int timeout = std::max<int>(0, std::chrono::duration_cast<std::chrono::milliseconds>(next_tick - Clock::now()).count());
+         int count = epoll_wait(worker.epoll_fd, events, max_events, timeout);
+
+         for (int i = 0; i < count; ++i) {
+            if (events[i].data.fd != worker.wake_fd) {
+               read_client(worker, events[i].data.fd);
+               continue;
+            }
+            std::uint64_t value;
+            read(worker.wake_fd, &value, sizeof(value));
+
+            std::lock_guard lock {worker.incoming_mutex};
+            for (const auto& fds : worker.incoming) {
+               start_match(worker, fds);
+            }
+            worker.incoming.clear();
+         }
+
+         auto now = Clock::now();
+         if (now < next_tick) {
+            continue;
+         }
+
+         std::vector<float> times;
+         for (auto& match : worker.matches) {
+            auto start = Clock::now();
+            tick_match(worker, *match);
+            times.push_back(std::chrono::duration<float>(Clock::now() - start).count());
+         }
+
+         int restarts = 0;
+         for (auto& match : worker.matches) {
+            bool abandoned = not match->synthetic and match->clients[0].fd < 0 and match->clients[1].fd < 0;
+            if (match->sim.lost or abandoned) {
+               drop_client(worker, match->clients[0]);
+               drop_client(worker, match->clients[1]);
+               restarts += match->synthetic;
+               match.reset();
+            }
+         }
+         std::erase_if(worker.matches, [](const auto& match) { return match == nullptr; });
+
+         for (int i = 0; i < restarts; ++i) {
+            start_match(worker, {-1, -1});
+         }
+
+         // Matches handed over since the last tick count too, so the count never loses them
+
+         {
+            std::lock_guard lock {worker.incoming_mutex};
+            worker.match_count = worker.matches.size() + worker.incoming.size();
+         }
+
+         double busy = std::chrono::duration<double>(Clock::now() - now).count();
+         next_tick += tick;
+         bool overrun = Clock::now() > next_tick;
+         if (overrun) {
+            next_tick = Clock::now() + tick;
+         }
+
+         std::lock_guard lock {worker.stats_mutex};
+         worker.tick_times.insert(worker.tick_times.end(), times.begin(), times.end());
+         worker.busy_time += busy;
+         worker.overruns += overrun;
+      }
+
+      for (auto& match : worker.matches) {
+         drop_client(worker, match->clients[0]);
+         drop_client(worker, match->clients[1]);
+      }
+   }
+
+   // Hand a pair of sockets to the least loaded worker
+
+   void assign_match(std::vector<std::unique_ptr<Worker>>& workers, const std::array<int, 2>& fds) {
+      auto& worker = **std::min_element(workers.begin(), workers.end(), [](const auto& a, const auto& b) {
+         return a->match_count < b->match_count;
+      });
+      {
+         std::lock_guard lock {worker.incoming_mutex};
+         worker.incoming.push_back(fds);
+         worker.match_count++;
+      }
+      std::uint64_t value = 1;
+      write(worker.wake_fd, &value, sizeof(value));
+   }
+
+   // Report, per-match tick latency and the matches one core could tick at this latency
+
+   void report(std::vector<std::unique_ptr<Worker>>& workers, double elapsed) {
+      std::vector<float> times;
+      double busy = 0;
+      int matches = 0, overruns = 0;
+
+      for (auto& worker : workers) {
+         std::lock_guard lock {worker->stats_mutex};
+         times.insert(times.end(), worker->tick_times.begin(), worker->tick_times.end());
+         busy += worker->busy_time;
+         overruns += worker->overruns;
+         matches += worker->match_count;
+         worker->tick_times.clear();
+         worker->busy_time = 0;
+         worker->overruns = 0;
+      }
+
+      if (times.empty()) {
+         std::printf("matches: %d, no ticks\n", matches);
+         return;
+      }
+      std::sort(times.begin(), times.end());
+      double total = 0;
+      for (auto time : times) {
+         total += time;
+      }
+      double mean = total / times.size();
+      float p99 = times[std::min<size_t>(times.size() - 1, times.size() * .99)];
+
+      std::printf("matches: %d, match tick mean: %.1fus, p99: %.1fus, core load: %.1f%%, overruns: %d, capacity: %.0f matches/core\n",
+         matches, mean * 1e6, p99 * 1e6, busy / elapsed / workers.size() * 100.0, overruns, tick_time / mean);
+      std::fflush(stdout);
+   }
+}
+
+// Run server
+
+int run_server(const ServerConfig& config) {
+   int listen_fd = listen_on(config.port);
+   if (listen_fd < 0) {
+      std::fprintf(stderr, "Could not listen on port %d\n", config.port);
+      return 1;
+   }
+
+   int thread_count = (config.threads > 0 ? config.threads : std::max(1u, std::thread::hardware_concurrency()));
+   std::vector<std::unique_ptr<Worker>> workers;
+   running = true;
+
+   for (int i = 0; i < thread_count; ++i) {
+      auto worker = std::make_unique<Worker>();
+      worker->cpu = i % std::max(1u, std::thread::hardware_concurrency());
+      worker->epoll_fd = epoll_create1(0);
+      worker->wake_fd = eventfd(0, EFD_NONBLOCK);
+
+      epoll_event event {};
+      event.events = EPOLLIN;
+      event.data.fd = worker->wake_fd;
+      epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->wake_fd, &event);
+      workers.push_back(std::move(worker));
+   }
+
+   for (auto& worker : workers) {
+      worker->thread = std::thread(run_worker, std::ref(*worker));
+   }
+
+   for (int i = 0; i < config.load; ++i) {
+      assign_match(workers, {-1, -1});
+   }
+
+   int epoll_fd = epoll_create1(0);
+   epoll_event event {};
+   event.events = EPOLLIN;
+   event.data.fd = listen_fd;
+   epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+
+   auto start = Clock::now(), last_report = start;
+   int waiting = -1;
+
+   while (config.duration <= 0.f or std::chrono::duration<float>(Clock::now() - start).count() < config.duration) {
+      epoll_event events[1];
+      epoll_wait(epoll_fd, events, 1, 100);
+
+      int fd;
+      while ((fd = accept(listen_fd, nullptr, nullptr)) >= 0) {
+         if (waiting < 0) {
+            waiting = fd;
+         } else {
+            assign_match(workers, {waiting, fd});
+            waiting = -1;
+         }
+      }
+
+      double elapsed = std::chrono::duration<double>(Clock::now() - last_report).count();
+      if (elapsed >= config.report_interval) {
+         report(workers, elapsed);
+         last_report = Clock::now();
+      }
+   }
+
+   running = false;
+   for (auto& worker : workers) {
+      worker->thread.join();
+      close(worker->epoll_fd);
+      close(worker->wake_fd);
+   }
+
+   if (waiting >= 0) {
+      close(waiting);
+   }
+   close(epoll_fd);
+   close(listen_fd);
+   return 0;
+}
@@ -0,0 +1,671 @@
+#include "simulation.hpp"
+
+// Includes
+
+#include "util/bytes.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+
+using namespace std::string_literals;
+
+// Constants
+
+namespace {
+   // Tetromino width and height must be the same!
+   static const std::vector<Tetromino> tetrominoes {
+      {{{1, 1}, {1, 1}}},
+      {{{0, 0, 1}, {1, 1, 1}, {0, 0, 0}}},
+      {{{1, 0, 0}, {1, 1, 1}, {0, 0, 0}}},
+      {{{0, 1, 1}, {1, 1, 0}, {0, 0, 0}}},
+      {{{1, 1, 0}, {0, 1, 1}, {0, 0, 0}}},
+      {{{0, 1, 0}, {1, 1, 1}, {0, 0, 0}}},
+      {{{0, 0, 0, 0}, {1, 1, 1, 1}, {0, 0, 0, 0}, {0, 0, 0, 0}}},
+   };
+
+   static const std::unordered_map<int, std::vector<Vector2>> wall_kick_data_jlstz {
+      {0, {{0, 0}, {-1, 0}, {-1, -1}, {-1, +2}, {0, -2}}},
+      {1, {{0, 0}, {+1, 0}, {+1, +1}, {+1, +2}, {0, -2}}},
+      {2, {{0, 0}, {+1, 0}, {+1, -1}, {+1, +2}, {0, -2}}},
+      {3, {{0, 0}, {-1, 0}, {-1, +1}, {-1, +2}, {0, -2}}},
+   };
+
+   static const std::unordered_map<int, std::vector<Vector2>> wall_kick_data_i {
+      {0, {{0, 0}, {-2, 0}, {+1, 0}, {-2, +1}, {+1, -2}}},
+      {1, {{0, 0}, {-1, 0}, {+2, 0}, {-1, -2}, {+2, +1}}},
+      {2, {{0, 0}, {+2, 0}, {-1, 0}, {+2, -1}, {-1, +2}}},
+      {3, {{0, 0}, {+1, 0}, {-2, 0}, {+1, +2}, {-2, -1}}},
+   };
+
+   static const std::vector<Color> colors {
+      RED, ORANGE, YELLOW, GREEN, BLUE, PURPLE, PINK,
+   };
+
+   static const std::vector<float> level_speeds {
+      1.1f, 1.f, .9f, .8f, .7f, .6f, .55f, .5f, .45f, .4f, .35f, .3f, .25f, .2f, .1f, .085f
+   };
+
+   constexpr Color versus_tile_color {64, 64, 64, 255};
+   constexpr Vector2 next_grid {6, 6};
+   constexpr int rows_for_level_up = 9;
+   constexpr float keys_down_for_press = .325f;
+   constexpr float keys_down_time = .04f;
+   constexpr float dig_start_fraction = .5f;
+   constexpr float dig_rise_time = 6.f;
+   constexpr int dig_move_chance = 30;
+
+   // Kernel, the board loops with the width known at compile time for the standard grids so
+   // the row loops unroll and vectorize. A width of zero reads it from the board.
+
+   template <int Width>
+   struct Kernel {
+      static int width(const Board& board) {
+         return (Width ? Width : board.width);
+      }
+
+      // Fits, against the locked tiles and, when given, the pieces of other players
+
+      static bool fits(const Board& board, const Tetromino& tetromino, int px, int py, const unsigned char* active = nullptr, unsigned char owner = 0) {
+         int size = tetromino.tiles.size();
+         for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+               if (not tetromino.tiles[y][x]) {
+                  continue;
+               }
+
+               int bx = px + x, by = py + y;
+               if (bx < 0 or by < 0 or bx >= width(board) or by >= board.height or board.row(by)[bx]) {
+                  return false;
+               }
+
+               unsigned char other = (active ? active[by * width(board) + bx] : 0);
+               if (other and other != owner) {
+                  return false;
+               }
+            }
+         }
+         return true;
+      }
+
+      // Full rows, top to bottom, and the full rows without garbage in them
+
+      static void full_rows(const Board& board, std::vector<int>& cleared, std::vector<int>& versus_cleared) {
+         for (int y = 1; y < board.height - 1; ++y) {
+            const unsigned char* row = board.row(y);
+            bool full = true, versus_blocks = false;
+            for (int x = 1; x < width(board) - 1; ++x) {
+               full &= row[x] != Tile::off;
+               versus_blocks |= row[x] == Tile::garbage;
+            }
+
+            if (full) {
+               cleared.push_back(y);
+               if (not versus_blocks) {
+                  versus_cleared.push_back(y);
+               }
+            }
+         }
+      }
+
+      static bool empty(const Board& board) {
+         bool filled = false;
+         for (int y = 1; y < board.height - 1; ++y) {
+            const unsigned char* row = board.row(y);
+            for (int x = 1; x < width(board) - 1; ++x) {
+               filled |= row[x] != Tile::off;
+            }
+         }
+         return not filled;
+      }
+   };
+
+   // With kernel, calls f with the kernel specialized for the board's width
+
+   template <typename F>
+   auto with_kernel(const Board& board, F&& f) {
+      switch (board.width) {
+      case 12:
+         return f(Kernel<12>{});
+      case 18:
+         return f(Kernel<18>{});
+      default:
+         return f(Kernel<0>{});
+      }
+   }
+}
+
+// Tile functions
+
+// Tile color, the palette color of a piece tile or the color of a tag
+
+Color tile_color(unsigned char tile) {
+   if (tile == Tile::border) {
+      return GRAY;
+   } else if (tile == Tile::garbage) {
+      return versus_tile_color;
+   }
+   return colors[(tile - 1) % colors.size()];
+}
+
+// Rotation functions
+
+// Rotated, the tetromino turned clockwise once
+
+Tetromino rotated(const Tetromino& tetromino) {
+   Tetromino new_tetromino = tetromino;
+   int size = tetromino.tiles.size();
+
+   for (int y = 0; y < size; ++y) {
+      for (int x = 0; x < size; ++x) {
+         new_tetromino.tiles[y][x] = tetromino.tiles[size - x - 1][y];
+      }
+   }
+   new_tetromino.rotation = (tetromino.rotation + 1) % 4;
+   return new_tetromino;
+}
+
+// Wall kicks, the offsets tried in order when rotating from the tetromino's rotation
+
+const std::vector<Vector2>& wall_kicks(const Tetromino& tetromino) {
+   static const std::vector<Vector2> no_kicks;
+   if (tetromino.tiles.size() == 2) {
+      return no_kicks;
+   }
+   return (tetromino.tiles.size() == 3 ? wall_kick_data_jlstz.at(tetromino.rotation) : wall_kick_data_i.at(tetromino.rotation));
+}
+
+// Constructor
+
+Simulation::Simulation(const Vector2& grid, int player_count, bool versus, unsigned int seed)
+   : rng(seed), grid(grid), player_count(player_count), seed(seed), versus(versus) {
+   tiles.assign(versus + 1, Board(grid.x, grid.y));
+   garbage.resize(tiles.size());
+
+   if (versus) {
+      player_count *= 2;
+   }
+   next_tiles.assign(player_count, Board(next_grid.x, next_grid.y));
+
+   for (int i = 0; i < player_count; ++i) {
+      Player player;
+      player.id = i;
+      player.board = versus and i > this->player_count / 2;
+      player.tetromino = get_random_tetromino(player);
+      player.color = get_random_color();
+      player.next_tetromino = get_random_tetromino(player);
+      player.next_color = get_random_color();
+      draw_next_tetromino(player);
+
+      if (versus) {
+         player.starting_pos = player.pos = {(float)int(int(grid.x - 2) / (player_count / 2 + 1) * (i % (player_count / 2) + 1)), 1};
+      } else {
+         player.starting_pos = player.pos = {(float)int((grid.x - 2) * (i + 1) / (player_count + 1)), 1};
+      }
+      players.push_back(player);
+   }
+
+   // Boards shared by several players keep an index of the pieces in flight so pieces collide
+
+   if (players.size() > tiles.size()) {
+      active.assign(tiles.size(), std::vector<unsigned char>(grid.x * grid.y, 0));
+      for (auto& player : players) {
+         player.waiting = not can_move(player.tetromino, player.pos, Path::current, player);
+         if (not player.waiting) {
+            index_piece(player, player.tetromino, player.pos, player.id + 1);
+         }
+      }
+   }
+}
+
+// Update functions
+
+// Step, advances every player by dt using one input per player
+
+void Simulation::step(const std::vector<Input>& inputs, float dt) {
+   if (lost) {
+      return;
+   }
+   time += dt;
+
+   // The column rises on a timer that shortens with the level, and the rows queue until the
+   // next lock like garbage
+
+   if (dig) {
+      rise_timer += dt;
+      float rise_after = dig_rise_time * level_speeds[level] / level_speeds[0];
+      if (rise_timer >= rise_after) {
+         rise_timer -= rise_after;
+         garbage[0].push_back(next_dig_row());
+      }
+   }
+
+   // Players move in id order, and each sees the pieces of the players before it where they
+   // ended up this tick
+
+   for (auto& player : players) {
+      const Input& input = inputs[player.id];
+      Input previous = player.previous_input;
+      player.previous_input = input;
+
+      if (player.waiting and not spawn(player)) {
+         if (lost) {
+            return;
+         }
+         continue;
+      }
+      index_piece(player, player.tetromino, player.pos, 0);
+
+      if ((input.held & Input::rotate) and not (previous.held & Input::rotate)) {
+         rotate(player);
+      }
+
+      if (key_down(input, previous, Input::down, player.soft_drop_timer, dt) and can_move(player.tetromino, player.pos, Path::down, player)) {
+         player.pos.y++;
+         player.down_timer = 0.f;
+         player.soft_drop = true;
+      }
+
+      player.pos.x += (key_down(input, previous, Input::right, player.right_timer, dt) and can_move(player.tetromino, player.pos, Path::right, player));
+      player.pos.x -= (key_down(input, previous, Input::left, player.left_timer, dt) and can_move(player.tetromino, player.pos, Path::left, player));
+
+      if ((input.held & Input::send) and not (previous.held & Input::send)) {
+         while (can_move(player.tetromino, player.pos, Path::down, player)) {
+            player.pos.y++;
+         }
+         player.down_timer = down_after;
+         player.hard_drop = true;
+      }
+
+      player.down_timer += dt;
+
+      if (player.down_timer >= down_after) {
+         player.down_timer -= down_after;
+
+         if (can_move(player.tetromino, player.pos, Path::down, player)) {
+            player.pos.y++;
+         } else if (can_move(player.tetromino, player.pos, Path::down, player, false)) {
+            // Resting on another player's piece, which may still move away
+         } else {
+            draw_tetromino(player);
+            record(player, TelemetryEvent::lock, player.tetromino.rotation, player.hard_drop);
+            sounds.push_back("place"s);
+
+            clear_cleared_rows(player);
+            if (versus or dig or royale) {
+               insert_garbage(player.board);
+            }
+            if (not active.empty()) {
+               lift_pieces(player);
+            }
+            player.tetromino = player.next_tetromino;
+            player.color = player.next_color;
+            player.next_tetromino = get_random_tetromino(player);
+            player.next_color = get_random_color();
+            draw_next_tetromino(player);
+
+            player.pos = player.starting_pos;
+            player.down_timer = 0.f;
+            player.pieces++;
+
+            if (player.soft_drop or player.hard_drop) {
+               add_drop_score(player, player.hard_drop);
+            }
+            player.soft_drop = player.hard_drop = false;
+
+            player.waiting = true;
+            if (not spawn(player)) {
+               if (lost) {
+                  return;
+               }
+               continue;
+            }
+         }
+      }
+      index_piece(player, player.tetromino, player.pos, player.id + 1);
+
+      int original = player.pos.y;
+      player.preview_y = player.pos.y;
+
+      while (can_move(player.tetromino, player.pos, Path::down, player)) {
+         player.pos.y = player.preview_y = player.pos.y + 1;
+      }
+      player.pos.y = original;
+   }
+}
+
+// Utility functions
+
+// Spawn, puts a waiting piece on the board. The game is lost when the tiles block it, and it
+// keeps waiting while another player's piece does.
+
+bool Simulation::spawn(Player& player) {
+   const Board& board = tiles[player.board];
+   bool blocked = with_kernel(board, [&](auto kernel) { return not kernel.fits(board, player.tetromino, player.pos.x, player.pos.y); });
+
+   if (blocked) {
+      lost = true;
+      left_win = player.id > player_count / 2;
+      sounds.push_back("lost"s);
+
+      for (auto& p : players) {
+         p.preview_y = p.pos.y;
+      }
+      return false;
+   }
+
+   if (not can_move(player.tetromino, player.pos, Path::current, player)) {
+      player.preview_y = player.pos.y;
+      return false;
+   }
+   player.waiting = false;
+   record(player, TelemetryEvent::spawn, player.pieces, player.color);
+   return true;
+}
+
+// Draw tetromino
+
+void Simulation::draw_tetromino(const Player& player) {
+   for (int y = player.pos.y; y < grid.y and y < player.pos.y + (int)player.tetromino.tiles.size(); ++y) {
+      for (int x = player.pos.x; x < grid.x and x < player.pos.x + (int)player.tetromino.tiles.size(); ++x) {
+         int id = player.board;
+
+         if (player.tetromino.tiles[y - player.pos.y][x - player.pos.x] and tiles[id](x, y) != Tile::border) {
+            tiles[id].set(x, y, player.color);
+         }
+      }
+   }
+}
+
+// Draw next tetromino
+
+void Simulation::draw_next_tetromino(const Player& player) {
+   auto& board = next_tiles[player.id];
+   for (int y = 1; y < next_grid.y - 1; ++y) {
+      std::fill_n(board.edit_row(y) + 1, next_grid.x - 2, Tile::off);
+   }
+   int ox = 1 + (player.next_tetromino.tiles.size() != 4);
+   int oy = 1 + (player.next_tetromino.tiles.size() == 2);
+
+   for (int y = oy; y < player.next_tetromino.tiles.size() + oy; ++y) {
+      for (int x = ox; x < player.next_tetromino.tiles.size() + ox; ++x) {
+         if (player.next_tetromino.tiles[y - oy][x - ox]) {
+            board.set(x, y, player.next_color);
+         }
+      }
+   }
+}
+
+// Can move tetromino
+
+bool Simulation::can_move(const Tetromino& tetromino, const Vector2& pos, Path type, const Player& player, bool pieces) {
+   int px = pos.x - (type == Path::left) + (type == Path::right);
+   int py = pos.y + (type == Path::down);
+   const Board& board = tiles[player.board];
+   const unsigned char* others = (active.empty() or not pieces ? nullptr : active[player.board].data());
+
+   return with_kernel(board, [&](auto kernel) { return kernel.fits(board, tetromino, px, py, others, player.id + 1); });
+}
+
+// Index piece, writes the player's cells into the board's index of pieces in flight. A value
+// of zero removes them.
+
+void Simulation::index_piece(const Player& player, const Tetromino& tetromino, const Vector2& pos, unsigned char value) {
+   if (active.empty()) {
+      return;
+   }
+   auto& cells = active[player.board];
+   int width = tiles[player.board].width, height = tiles[player.board].height;
+
+   for (int y = 0; y < tetromino.tiles.size(); ++y) {
+      for (int x = 0; x < tetromino.tiles.size(); ++x) {
+         int bx = pos.x + x, by = pos.y + y;
+         if (tetromino.tiles[y][x] and bx >= 0 and by >= 0 and bx < width and by < height) {
+            cells[by * width + bx] = value;
+         }
+      }
+   }
+}
+
+// Lift pieces, moves pieces of other players up out of tiles that a clear or garbage shifted
+// into them
+
+void Simulation::lift_pieces(const Player& locked) {
+   for (auto& player : players) {
+      if (player.id == locked.id or player.board != locked.board or player.waiting) {
+         continue;
+      }
+
+      Vector2 original = player.pos;
+      while (player.pos.y > 0 and not can_move(player.tetromino, player.pos, Path::current, player)) {
+         player.pos.y--;
+      }
+
+      if (player.pos.y != original.y) {
+         index_piece(player, player.tetromino, original, 0);
+         index_piece(player, player.tetromino, player.pos, player.id + 1);
+      }
+   }
+}
+
+// Rotate tetromino
+
+void Simulation::rotate(Player& player) {
+   Vector2 original_pos = player.pos;
+   Tetromino new_tetromino = rotated(player.tetromino);
+
+   const auto& kicks = wall_kicks(player.tetromino);
+   for (int kick = 0; kick < kicks.size(); ++kick) {
+      player.pos = {original_pos.x + kicks[kick].x, original_pos.y + kicks[kick].y};
+
+      bool can_rotate = can_move(new_tetromino, player.pos, Path::current, player);
+      if (can_rotate) {
+         player.tetromino = new_tetromino;
+         record(player, TelemetryEvent::rotate, player.tetromino.rotation, kick);
+         return;
+      }
+   }
+   player.pos = original_pos;
+}
+
+// Clear cleared rows
+
+void Simulation::clear_cleared_rows(const Player& player) {
+   int id = player.board;
+   int last_difficult = difficult_count;
+   std::vector<int> cleared, versus_cleared;
+
+   with_kernel(tiles[id], [&](auto kernel) { kernel.full_rows(tiles[id], cleared, versus_cleared); });
+
+   if ((versus or royale) and versus_cleared.size() > 1) {
+      std::vector<std::uint64_t> lines;
+      for (auto cy = versus_cleared.rbegin(); cy != versus_cleared.rend(); ++cy) {
+         std::uint64_t holes = 0;
+         for (int x = 1; x < grid.x - 1 and x <= 64; ++x) {
+            int px = x - player.pos.x, py = *cy - player.pos.y, sz = player.tetromino.tiles.size();
+            bool filled = px < 0 or px >= sz or py < 0 or py >= sz or not player.tetromino.tiles[py][px];
+            holes |= std::uint64_t(not filled) << (x - 1);
+         }
+         lines.push_back(holes);
+      }
+
+      int cancelled = std::min(lines.size(), garbage[id].size());
+      garbage[id].erase(garbage[id].begin(), garbage[id].begin() + cancelled);
+      auto& sent = (royale ? outbox : garbage[not id]);
+      sent.insert(sent.end(), lines.begin() + cancelled, lines.end());
+
+      if (cancelled < lines.size()) {
+         sounds.push_back("send"s);
+      }
+      record(player, TelemetryEvent::garbage, lines.size() - cancelled, cancelled);
+   }
+
+   for (const auto& cy : cleared) {
+      tiles[id].remove_row(cy);
+   }
+   dug += cleared.size() - versus_cleared.size();
+   int last_level = level;
+   total_clears += cleared.size();
+   level = std::min(total_clears / rows_for_level_up, 15);
+   down_after = level_speeds[level];
+
+   if (level != last_level) {
+      record(player, TelemetryEvent::level, level);
+   }
+
+   if (versus or royale) {
+      return;
+   }
+
+   bool perfect = with_kernel(tiles[id], [&](auto kernel) { return kernel.empty(tiles[id]); });
+
+   if (cleared.empty()) {
+      combo_count = -1;
+   } else {
+      combo_count++;
+      add_score(50 * combo_count);
+      sounds.push_back("combo"s);
+   }
+
+   if (cleared.size() == 1) {
+      add_score((perfect ? 800 : 100));
+   } else if (cleared.size() == 2) {
+      add_score((perfect ? 1200 : 300));
+   } else if (cleared.size() == 3) {
+      add_score((perfect ? 1800 : 500));
+   } else if (cleared.size() == 4) {
+      add_score((perfect ? 2600 : 800));
+      difficult_count++;
+   }
+
+   if (cleared.size() != 4 and not cleared.empty()) {
+      difficult_count = 0;
+   }
+
+   if (difficult_count >= 2 and last_difficult != difficult_count) {
+      sounds.push_back("back_to_back"s);
+   }
+
+   if (not cleared.empty()) {
+      record(player, TelemetryEvent::clear, cleared.size(), combo_count, difficult_count);
+   }
+}
+
+// Insert garbage, every queued line rises from the bottom in queue order
+
+void Simulation::insert_garbage(int id) {
+   int count = std::min<int>(garbage[id].size(), grid.y - 2);
+   if (count == 0) {
+      return;
+   }
+   auto& board = tiles[id];
+
+   for (int i = 0; i < count; ++i) {
+      auto* row = board.rise();
+      for (int x = 1; x < grid.x - 1; ++x) {
+         bool hole = x <= 64 and garbage[id][i] >> (x - 1) & 1;
+         row[x] = (hole ? Tile::off : Tile::garbage);
+      }
+   }
+   garbage[id].clear();
+}
+
+// Start dig, fills the bottom of the board from the column
+
+void Simulation::start_dig() {
+   dig = true;
+   dig_hole = mix(seed) % std::min<int>(grid.x - 2, 64);
+   for (int i = 0; i < (grid.y - 2) * dig_start_fraction; ++i) {
+      garbage[0].push_back(next_dig_row());
+   }
+   insert_garbage(0);
+}
+
+// Next dig row, the holes of the next row of the endless column. A hole mostly stays above
+// the one of the row before and sometimes moves, by a hash of the seed and the row's index,
+// so the column is streamed from a few numbers and never stored.
+
+std::uint64_t Simulation::next_dig_row() {
+   std::uint64_t hash = mix(std::uint64_t(seed) << 32 ^ dig_rows++);
+   if (hash % 100 < dig_move_chance) {
+      dig_hole = (hash >> 8) % std::min<int>(grid.x - 2, 64);
+   }
+   return std::uint64_t(1) << dig_hole;
+}
+
+// Record, queues a telemetry event for the caller to pass on once the tick is final
+
+void Simulation::record(const Player& player, TelemetryEvent::Type type, int a, int b, int c) {
+   if (not telemetry) {
+      return;
+   }
+   TelemetryEvent event;
+   event.type = type;
+   event.player = player.id;
+   event.x = player.pos.x;
+   event.y = player.pos.y;
+   event.a = a;
+   event.b = b;
+   event.c = c;
+   events.push_back(event);
+}
+
+// Add drop score
+
+void Simulation::add_drop_score(const Player& player, bool hard) {
+   for (int y = 0; y < player.tetromino.tiles.size(); ++y) {
+      for (int x = 0; x < player.tetromino.tiles.size(); ++x) {
+         score += player.tetromino.tiles[y][x] * (hard + 1);
+      }
+   }
+}
+
+// Add score
+
+void Simulation::add_score(int plus) {
+   int level_multiplier = (level == 0 ? 1 : level);
+   score += plus * level_multiplier * (difficult_count >= 2 ? 1.5f : 1.f);
+}
+
+// Get a random tetromino. The bag is shuffled with a Fisher-Yates over the engine's raw output
+// rather than std::shuffle, whose draws differ between standard libraries, so peers and replays
+// built with different toolchains deal the same pieces.
+
+Tetromino Simulation::get_random_tetromino(Player& player) {
+   if (player.bag.empty()) {
+      player.bag = tetrominoes;
+      for (int i = player.bag.size() - 1; i > 0; --i) {
+         std::swap(player.bag[i], player.bag[rng() % (i + 1)]);
+      }
+   }
+   auto tetromino = player.bag.back();
+   player.bag.pop_back();
+   return tetromino;
+}
+
+// Get a random color
+
+unsigned char Simulation::get_random_color() {
+   return 1 + rng() % colors.size();
+}
+
+// Is versus block
+
+bool Simulation::is_versus_block(unsigned char tile) {
+   return tile == Tile::garbage;
+}
+
+// Key down, a press or an auto-repeat once the key has been held long enough
+
+bool Simulation::key_down(const Input& input, const Input& previous, Input::Key key, float& timer, float dt) {
+   if (input.held & key) {
+      timer += dt;
+   } else {
+      timer = 0;
+   }
+
+   if (timer >= keys_down_for_press) {
+      timer -= keys_down_time;
+      return true;
+   }
+   return (input.held & key) and not (previous.held & key);
+}
@@ -0,0 +1,273 @@
+#include "solver.hpp"
+
+// Includes
+
+#include "bot.hpp"
+#include "savestate.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <unordered_set>
+
+// Constants
+
+namespace {
+   using Clock = std::chrono::steady_clock;
+
+   constexpr Vector2 single_mode_grid {12, 22};
+   constexpr int piece_cells = 4;
+   constexpr int clock_check_interval = 256;
+   constexpr int spawn_rows = 4;
+   constexpr float analysis_time_budget = 60.f;
+
+   // Within rows, every cell of the placement is in the bottom rows of the board
+
+   bool within_rows(const PlacementBoard& board, const Placement& placement, int rows) {
+      for (int y = 0; y < placement.tetromino.tiles.size(); ++y) {
+         for (int x = 0; x < placement.tetromino.tiles.size(); ++x) {
+            if (placement.tetromino.tiles[y][x] and placement.pos.y + y < board.height - 1 - rows) {
+               return false;
+            }
+         }
+      }
+      return true;
+   }
+
+   // Search, one first-level branch. Boards already shown to be dead at a depth are
+   // remembered, and the search gives up once any branch has a solution or time runs out.
+
+   struct Search {
+      const std::vector<Tetromino>& pieces;
+      Vector2 spawn;
+      Clock::time_point deadline;
+      std::atomic<bool>& solved;
+      std::atomic<bool>& timed_out;
+
+      std::unordered_set<std::uint64_t> dead;
+      std::vector<Placement> path;
+      long long nodes = 0;
+
+      Search(const std::vector<Tetromino>& pieces, const Vector2& spawn, Clock::time_point deadline, std::atomic<bool>& solved,
+         std::atomic<bool>& timed_out)
+         : pieces(pieces), spawn(spawn), deadline(deadline), solved(solved), timed_out(timed_out) {
+      }
+
+      bool aborted() {
+         if (solved.load(std::memory_order_relaxed) or timed_out.load(std::memory_order_relaxed)) {
+            return true;
+         }
+         if (nodes % clock_check_interval == 0 and Clock::now() >= deadline) {
+            timed_out = true;
+            return true;
+         }
+         return false;
+      }
+
+      // Solve, places pieces from depth on so the board is empty after the last one, keeping
+      // every cell within the bottom rows
+
+      bool solve(const PlacementBoard& board, int depth, int last, int rows) {
+         if (depth == last) {
+            return board.empty();
+         }
+         nodes++;
+         if (aborted()) {
+            return false;
+         }
+
+         std::uint64_t key = hash_board(board) ^ (std::uint64_t(depth) * 0x9E3779B97F4A7C15ull);
+         if (dead.count(key)) {
+            return false;
+         }
+
+         for (const auto& placement : enumerate_placements(board, pieces[depth], spawn, false)) {
+            if (not within_rows(board, placement, rows)) {
+               continue;
+            }
+            PlacementBoard child = board;
+            int cleared = child.lock(placement.tetromino, placement.pos);
+
+            if (solve(child, depth + 1, last, rows - cleared)) {
+               path.push_back(placement);
+               return true;
+            }
+         }
+
+         if (not aborted()) {
+            dead.insert(key);
+         }
+         return false;
+      }
+   };
+
+   // Add inputs, replays the found placements to get the key presses reaching each of them
+
+   void add_inputs(const PlacementBoard& start, std::vector<Placement>& placements, const Vector2& spawn) {
+      PlacementBoard board = start;
+      for (auto& placement : placements) {
+         for (auto& candidate : enumerate_placements(board, placement.tetromino, spawn)) {
+            if (candidate.tetromino.rotation == placement.tetromino.rotation and candidate.pos.x == placement.pos.x and candidate.pos.y == placement.pos.y) {
+               placement.inputs = std::move(candidate.inputs);
+               break;
+            }
+         }
+         board.lock(placement.tetromino, placement.pos);
+      }
+   }
+
+   void print_solution(const PerfectClear& solution, double seconds) {
+      if (solution.placements.empty()) {
+         const char* outcome = (solution.complete ? "no perfect clear" : solution.out_of_pieces ? "not enough known pieces" : "gave up");
+         std::printf("  %s after %lld nodes in %.3fs\n", outcome, solution.nodes, seconds);
+         return;
+      }
+      std::printf("  perfect clear in %zu pieces, %lld nodes in %.3fs\n", solution.placements.size(), solution.nodes, seconds);
+      for (const auto& placement : solution.placements) {
+         std::printf("    size %zu rotation %d at %d,%d\n", placement.tetromino.tiles.size(), placement.tetromino.rotation, int(placement.pos.x), int(placement.pos.y));
+      }
+   }
+}
+
+// Solver functions
+
+std::vector<Tetromino> upcoming_pieces(const Player& player) {
+   std::vector<Tetromino> pieces {player.tetromino, player.next_tetromino};
+   pieces.insert(pieces.end(), player.bag.rbegin(), player.bag.rend());
+   return pieces;
+}
+
+PerfectClear find_perfect_clear(const PlacementBoard& board, const std::vector<Tetromino>& pieces, const Vector2& spawn, int max_pieces,
+   float time_budget, ThreadPool& pool) {
+   auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(time_budget));
+   int width = board.width - 2, filled = 0, height = 0;
+
+   for (int y = 1; y < board.height - 1; ++y) {
+      for (int x = 1; x < board.width - 1; ++x) {
+         if (board.cells[y * board.width + x]) {
+            filled++;
+            height = std::max(height, board.height - 1 - y);
+         }
+      }
+   }
+
+   // Clears needing more pieces than are known can't be ruled out, so the result is only
+   // complete when the piece limit wasn't lowered to the known pieces
+
+   PerfectClear result;
+   result.complete = true;
+   int requested = max_pieces;
+   max_pieces = std::min<int>(max_pieces, pieces.size());
+   if (max_pieces == 0) {
+      result.complete = requested == 0;
+      result.out_of_pieces = not result.complete;
+      return result;
+   }
+
+   // A clear of some number of rows needs exactly the pieces that fill their empty cells
+
+   for (int rows = std::max(height, 1); rows < board.height - 1; ++rows) {
+      int empty = rows * width - filled;
+      if (empty % piece_cells != 0) {
+         continue;
+      }
+      int count = empty / piece_cells;
+      if (count > max_pieces) {
+         if (count <= requested) {
+            result.complete = false;
+            result.out_of_pieces = true;
+         }
+         break;
+      }
+
+      // Everything above the stack is empty, so searching only the rows being cleared plus
+      // room to spawn reaches the same placements with far fewer states
+
+      PlacementBoard field;
+      field.width = board.width;
+      field.height = rows + spawn_rows + 2;
+      int offset = board.height - field.height;
+      field.cells.assign(board.cells.begin() + offset * board.width, board.cells.end());
+      std::fill_n(field.cells.begin(), field.width, 1);
+      Vector2 field_spawn {spawn.x, 1};
+
+      auto first = enumerate_placements(field, pieces[0], field_spawn, false);
+      std::atomic<bool> solved = false, timed_out = false;
+      std::vector<std::unique_ptr<Search>> searches;
+
+      for (int i = 0; i < first.size(); ++i) {
+         searches.push_back(std::make_unique<Search>(pieces, field_spawn, deadline, solved, timed_out));
+         if (not within_rows(field, first[i], rows)) {
+            continue;
+         }
+
+         pool.submit([&, i] {
+            auto& search = *searches[i];
+            PlacementBoard child = field;
+            int cleared = child.lock(first[i].tetromino, first[i].pos);
+
+            if (search.solve(child, 1, count, rows - cleared) and not solved.exchange(true)) {
+               search.path.push_back(first[i]);
+            }
+         });
+      }
+      pool.wait();
+
+      for (const auto& search : searches) {
+         result.nodes += search->nodes;
+      }
+
+      for (const auto& search : searches) {
+         if (search->path.size() != count) {
+            continue;
+         }
+         result.placements.assign(search->path.rbegin(), search->path.rend());
+         for (auto& placement : result.placements) {
+            placement.pos.y += offset;
+         }
+         add_inputs(board, result.placements, spawn);
+         return result;
+      }
+
+      if (timed_out) {
+         result.complete = false;
+         return result;
+      }
+   }
+   return result;
+}
+
+// Run solver
+
+int run_solver(int max_pieces, const std::string& savestate_file, const std::vector<unsigned int>& seeds) {
+   ThreadPool pool;
+
+   auto solve = [&](const Simulation& sim) {
+      const Player& player = sim.players[0];
+      auto pieces = upcoming_pieces(player);
+      if (pieces.size() < max_pieces) {
+         std::printf("  searching up to %zu pieces, only the current, next and bag are known\n", pieces.size());
+      }
+      auto start = Clock::now();
+      auto solution = find_perfect_clear(PlacementBoard(sim.tiles[player.board]), pieces, player.starting_pos, max_pieces, analysis_time_budget, pool);
+      print_solution(solution, std::chrono::duration<double>(Clock::now() - start).count());
+   };
+
+   if (not savestate_file.empty()) {
+      auto savestate = read_savestate(savestate_file);
+      if (not savestate) {
+         std::fprintf(stderr, "Could not read savestate %s\n", savestate_file.c_str());
+         return 1;
+      }
+      std::printf("%s:\n", savestate_file.c_str());
+      solve(savestate->sim);
+      return 0;
+   }
+
+   for (auto seed : seeds) {
+      std::printf("seed %u:\n", seed);
+      solve(Simulation(single_mode_grid, 1, false, seed));
+      std::fflush(stdout);
+   }
+   return 0;
+}
@@ -0,0 +1,104 @@
+#include "spectator.hpp"
+
+// Includes
+
+#include "util/socket.hpp"
+#include "broadcast.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+// Constants
+
+namespace {
+   constexpr int read_size = 1 << 16;
+   constexpr auto first_frame_timeout = std::chrono::seconds(30);
+}
+
+// Destructor
+
+Spectator::~Spectator() {
+   if (fd >= 0) {
+      close(fd);
+   }
+}
+
+// Connect, waits until the first keyframe has been applied. A match server only sends it once
+// an opponent has joined.
+
+bool Spectator::connect(const std::string& host, int port, Simulation& sim) {
+   sockaddr_in address {};
+   address.sin_family = AF_INET;
+   address.sin_port = htons(port);
+   if (not resolve_host(host, address.sin_addr.s_addr)) {
+      return false;
+   }
+
+   fd = socket(AF_INET, SOCK_STREAM, 0);
+   if (fd < 0) {
+      return false;
+   }
+
+   if (::connect(fd, (sockaddr*)&address, sizeof(address)) < 0) {
+      return false;
+   }
+   fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+   connected = true;
+
+   auto deadline = std::chrono::steady_clock::now() + first_frame_timeout;
+   while (connected and sim.tiles.empty() and std::chrono::steady_clock::now() < deadline) {
+      receive(sim);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   }
+   return connected and not sim.tiles.empty();
+}
+
+// Receive, applies every complete frame that has arrived
+
+void Spectator::receive(Simulation& sim) {
+   unsigned char data[read_size];
+   while (connected) {
+      ssize_t size = recv(fd, data, read_size, 0);
+      if (size > 0) {
+         buffer.insert(buffer.end(), data, data + size);
+      } else if (size == 0 or (errno != EAGAIN and errno != EWOULDBLOCK)) {
+         connected = false;
+      } else {
+         break;
+      }
+   }
+
+   size_t offset = 0;
+   while (buffer.size() - offset >= sizeof(std::uint32_t)) {
+      ByteReader header {buffer.data() + offset, buffer.size() - offset};
+      size_t length = header.read<std::uint32_t>();
+
+      if (buffer.size() - offset - header.offset < length) {
+         break;
+      }
+      ByteReader reader {buffer.data() + offset + header.offset, length};
+      if (not apply_broadcast_frame(reader, sim)) {
+         connected = false;
+      }
+      offset += header.offset + length;
+   }
+   buffer.erase(buffer.begin(), buffer.begin() + offset);
+}
+
+// Send input, only when it changed since the last one that was sent. A send that fails is
+// tried again on the next call.
+
+void Spectator::send_input(const Input& input) {
+   if (not connected or input.held == sent_input.held) {
+      return;
+   }
+   if (send(fd, &input.held, 1, MSG_NOSIGNAL | MSG_DONTWAIT) == 1) {
+      sent_input = input;
+   }
+}
@@ -0,0 +1,192 @@
+#include "telemetry.hpp"
+
+// Includes
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Constants
+
+namespace {
+   using Clock = std::chrono::steady_clock;
+
+   constexpr std::uint32_t magic = 0x4C545042; // "BPTL"
+   constexpr std::uint16_t version = 1;
+   constexpr std::uint64_t ring_size = 1 << 14;
+   constexpr auto drain_interval = std::chrono::milliseconds(100);
+
+   static_assert((ring_size & (ring_size - 1)) == 0);
+
+   // Ring, written only by its thread and read only by the writer. The counters sit on their
+   // own cache lines so the two sides don't fight over them.
+
+   struct Ring {
+      std::array<TelemetryEvent, ring_size> events;
+      alignas(64) std::atomic<std::uint64_t> head = 0;
+      alignas(64) std::atomic<std::uint64_t> tail = 0;
+      std::atomic<std::uint64_t> dropped = 0;
+      std::uint64_t reported_dropped = 0;
+   };
+
+   // Global variables
+
+   std::mutex rings_mutex;
+   std::vector<std::unique_ptr<Ring>> rings; // Kept for the whole run so thread pointers stay valid
+
+   std::thread writer;
+   std::mutex mutex;
+   std::condition_variable stopping;
+   std::atomic<bool> recording = false;
+   bool running = false;
+   std::FILE* file = nullptr;
+   Clock::time_point start;
+
+   Ring& thread_ring() {
+      thread_local Ring* ring = nullptr;
+      if (not ring) {
+         std::lock_guard lock {rings_mutex};
+         ring = rings.emplace_back(std::make_unique<Ring>()).get();
+      }
+      return *ring;
+   }
+
+   // Drain, moves every event out of the rings in the order each thread recorded them
+
+   void drain(std::vector<TelemetryEvent>& buffer) {
+      std::lock_guard lock {rings_mutex};
+      for (auto& ring : rings) {
+         std::uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+         std::uint64_t head = ring->head.load(std::memory_order_acquire);
+
+         for (; tail != head; ++tail) {
+            buffer.push_back(ring->events[tail & (ring_size - 1)]);
+         }
+         ring->tail.store(tail, std::memory_order_release);
+
+         std::uint64_t dropped = ring->dropped.load(std::memory_order_relaxed);
+         if (dropped != ring->reported_dropped) {
+            TelemetryEvent event;
+            event.time = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+            event.type = TelemetryEvent::dropped;
+            event.a = std::min<std::uint64_t>(dropped - ring->reported_dropped, INT16_MAX);
+            buffer.push_back(event);
+            ring->reported_dropped = dropped;
+         }
+      }
+   }
+
+   // Writer, drains the rings a few times a second so recording threads never touch the file
+
+   void run_writer() {
+      std::vector<TelemetryEvent> buffer;
+      bool stop = false;
+
+      while (not stop) {
+         {
+            std::unique_lock lock {mutex};
+            stop = stopping.wait_for(lock, drain_interval, [] { return not running; });
+         }
+         buffer.clear();
+         drain(buffer);
+         std::fwrite(buffer.data(), sizeof(TelemetryEvent), buffer.size(), file);
+      }
+      std::fflush(file);
+   }
+
+   const char* type_name(int type) {
+      static constexpr const char* names[] {"spawn", "rotate", "lock", "clear", "garbage", "level", "dropped"};
+      return (type < std::size(names) ? names[type] : "unknown");
+   }
+}
+
+// Telemetry functions
+
+void start_telemetry(const std::string& path) {
+   stop_telemetry();
+   file = std::fopen(path.c_str(), "wb");
+   if (not file) {
+      return;
+   }
+   std::uint16_t event_size = sizeof(TelemetryEvent);
+   std::fwrite(&magic, sizeof(magic), 1, file);
+   std::fwrite(&version, sizeof(version), 1, file);
+   std::fwrite(&event_size, sizeof(event_size), 1, file);
+
+   start = Clock::now();
+   running = true;
+   recording.store(true, std::memory_order_release);
+   writer = std::thread(run_writer);
+}
+
+void stop_telemetry() {
+   if (not writer.joinable()) {
+      return;
+   }
+   recording = false;
+   {
+      std::lock_guard lock {mutex};
+      running = false;
+   }
+   stopping.notify_one();
+   writer.join();
+   std::fclose(file);
+   file = nullptr;
+}
+
+bool is_recording_telemetry() {
+   return recording.load(std::memory_order_relaxed);
+}
+
+// Record, stamps the event and appends it to this thread's ring
+
+void record_telemetry(TelemetryEvent event) {
+   if (not recording.load(std::memory_order_acquire)) {
+      return;
+   }
+   Ring& ring = thread_ring();
+   std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+
+   if (head - ring.tail.load(std::memory_order_acquire) >= ring_size) {
+      ring.dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+   }
+   event.time = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+   ring.events[head & (ring_size - 1)] = event;
+   ring.head.store(head + 1, std::memory_order_release);
+}
+
+// Export
+
+bool export_telemetry_csv(const std::string& path, std::FILE* out) {
+   std::FILE* in = std::fopen(path.c_str(), "rb");
+   if (not in) {
+      return false;
+   }
+   std::uint32_t header_magic = 0;
+   std::uint16_t header_version = 0, event_size = 0;
+   std::fread(&header_magic, sizeof(header_magic), 1, in);
+   std::fread(&header_version, sizeof(header_version), 1, in);
+   std::fread(&event_size, sizeof(event_size), 1, in);
+
+   if (header_magic != magic or header_version != version or event_size != sizeof(TelemetryEvent)) {
+      std::fclose(in);
+      return false;
+   }
+   std::fprintf(out, "time_us,frame_time,type,player,x,y,a,b,c\n");
+
+   TelemetryEvent event;
+   while (std::fread(&event, sizeof(event), 1, in) == 1) {
+      std::fprintf(out, "%llu,%.6f,%s,%d,%d,%d,%d,%d,%d\n", (unsigned long long)event.time, event.frame_time, type_name(event.type),
+         event.player, event.x, event.y, event.a, event.b, event.c);
+   }
+   std::fclose(in);
+   return true;
+}
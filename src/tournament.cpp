@@ -0,0 +1,208 @@
+#include "tournament.hpp"
+
+// Includes
+
+#include "util/thread_pool.hpp"
+#include "bot.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+// Constants
+
+namespace {
+   constexpr Vector2 versus_grid {12, 22};
+   constexpr BotLevel tournament_level {1e3f, 0.f, 400, 6};
+   constexpr float elo_scale = 400.f;
+   constexpr float elo_anchor = 1500.f;
+   constexpr int rating_iterations = 200;
+   constexpr int bootstrap_samples = 200;
+
+   // Entrant, a named bot strategy
+
+   struct Entrant {
+      std::string name;
+      BotWeights weights;
+      BotLevel level = tournament_level;
+   };
+
+   // Game, who played which side and the left side's score, one, a half or zero
+
+   struct Game {
+      int left = 0, right = 0;
+      float score = .5f;
+   };
+
+   std::vector<Entrant> default_entrants() {
+      Entrant greedy {"greedy", {}, tournament_level};
+      greedy.level.node_budget = 1;
+      greedy.level.beam_width = 1;
+      Entrant stacker {"stacker", {-.3f, -.36f, -.18f, -.1f, .4f}, tournament_level};
+      Entrant cautious {"cautious", {-.51f, -.8f, -.25f, -.1f, .76f}, tournament_level};
+      return {{"default", {}, tournament_level}, greedy, stacker, cautious};
+   }
+
+   std::vector<Entrant> read_entrants(const std::string& file) {
+      std::ifstream f {file};
+      std::vector<Entrant> entrants;
+      std::string line;
+
+      while (std::getline(f, line)) {
+         std::istringstream fields {line};
+         Entrant entrant;
+         auto& w = entrant.weights;
+         if (line.empty() or line[0] == '#' or not (fields >> entrant.name >> w.height >> w.holes >> w.bumpiness >> w.wells >> w.lines)) {
+            continue;
+         }
+         fields >> entrant.level.node_budget >> entrant.level.beam_width;
+         entrants.push_back(entrant);
+      }
+      return entrants;
+   }
+
+   // Play game, both bots lock their placements with a hard drop, so garbage and losing
+   // follow the game's own versus rules
+
+   float play_game(const Entrant& left, const Entrant& right, unsigned int seed, int max_pieces) {
+      Simulation sim(versus_grid, 1, true, seed);
+      const Entrant* sides[] {&left, &right};
+      std::vector<TranspositionTable> tables(sim.players.size());
+      std::vector<Input> inputs(sim.players.size());
+
+      while (not sim.lost and sim.players[0].pieces < max_pieces) {
+         for (auto& player : sim.players) {
+            const Entrant& entrant = *sides[player.board];
+            tables[player.id].clear();
+            inputs[player.id] = place_best(sim, player, entrant.weights, entrant.level, tables[player.id]);
+         }
+         sim.step(inputs, tick_time);
+         sim.sounds.clear();
+      }
+      return (not sim.lost ? .5f : sim.left_win ? 1.f : 0.f);
+   }
+
+   // Ratings, the Bradley-Terry strengths that best explain the results, found with the
+   // minorization-maximization updates and put on the Elo scale around the anchor. A draw
+   // counts as half a win for each side.
+
+   std::vector<float> ratings(const std::vector<Game>& games, int count) {
+      std::vector<double> wins(count), strength(count, 1.0);
+      std::vector<std::vector<int>> played(count, std::vector<int>(count));
+      for (const auto& game : games) {
+         wins[game.left] += game.score;
+         wins[game.right] += 1.f - game.score;
+         played[game.left][game.right]++;
+         played[game.right][game.left]++;
+      }
+
+      // A drawn game against an average opponent keeps an entrant that never won or never
+      // lost from running off to infinity
+
+      for (int iteration = 0; iteration < rating_iterations; ++iteration) {
+         std::vector<double> next(count);
+         double log_sum = 0;
+         for (int i = 0; i < count; ++i) {
+            double denominator = 1.0 / (strength[i] + 1.0);
+            for (int j = 0; j < count; ++j) {
+               if (played[i][j]) {
+                  denominator += played[i][j] / (strength[i] + strength[j]);
+               }
+            }
+            next[i] = (wins[i] + .5) / denominator;
+            log_sum += std::log(next[i]);
+         }
+         double mean = std::exp(log_sum / count);
+         for (int i = 0; i < count; ++i) {
+            strength[i] = next[i] / mean;
+         }
+      }
+
+      std::vector<float> elo(count);
+      for (int i = 0; i < count; ++i) {
+         elo[i] = elo_anchor + elo_scale * std::log10(strength[i]);
+      }
+      return elo;
+   }
+}
+
+// Run tournament
+
+int run_tournament(const TournamentConfig& config) {
+   auto entrants = (config.entrants.empty() ? default_entrants() : read_entrants(config.entrants));
+   if (entrants.size() < 2) {
+      std::fprintf(stderr, "A tournament needs at least two entrants\n");
+      return 1;
+   }
+   int count = entrants.size();
+
+   std::mt19937 rng {config.seed};
+   std::vector<unsigned int> seeds(config.games);
+   for (auto& seed : seeds) {
+      seed = rng();
+   }
+
+   std::vector<Game> games;
+   for (int a = 0; a < count; ++a) {
+      for (int b = a + 1; b < count; ++b) {
+         for (int g = 0; g < config.games; ++g) {
+            games.push_back({a, b});
+            games.push_back({b, a});
+         }
+      }
+   }
+
+   ThreadPool pool {config.threads};
+   std::printf("%d entrants, %zu games on %d threads\n", count, games.size(), pool.size());
+   std::fflush(stdout);
+
+   auto start = std::chrono::steady_clock::now();
+   for (int i = 0; i < games.size(); ++i) {
+      pool.submit([&, i] {
+         auto& game = games[i];
+         game.score = play_game(entrants[game.left], entrants[game.right], seeds[i / 2 % config.games], config.max_pieces);
+      });
+   }
+   pool.wait();
+   double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+   // Confidence intervals from rating games drawn again with replacement
+
+   auto elo = ratings(games, count);
+   std::vector<std::vector<float>> samples(count);
+   std::vector<Game> resampled(games.size());
+   std::uniform_int_distribution<std::size_t> pick(0, games.size() - 1);
+
+   for (int s = 0; s < bootstrap_samples; ++s) {
+      for (auto& game : resampled) {
+         game = games[pick(rng)];
+      }
+      auto sample = ratings(resampled, count);
+      for (int i = 0; i < count; ++i) {
+         samples[i].push_back(sample[i]);
+      }
+   }
+
+   std::vector<int> order(count);
+   for (int i = 0; i < count; ++i) {
+      order[i] = i;
+      std::sort(samples[i].begin(), samples[i].end());
+   }
+   std::sort(order.begin(), order.end(), [&](int a, int b) { return elo[a] > elo[b]; });
+
+   for (int i : order) {
+      float wins = 0, played = 0;
+      for (const auto& game : games) {
+         wins += (game.left == i ? game.score : game.right == i ? 1.f - game.score : 0.f);
+         played += game.left == i or game.right == i;
+      }
+      std::printf("%-16s %6.0f  [%6.0f, %6.0f]  %5.1f%% of %.0f games\n", entrants[i].name.c_str(), elo[i],
+         samples[i][bootstrap_samples * .025f], samples[i][bootstrap_samples * .975f], 100.f * wins / played, played);
+   }
+   std::printf("%.1fs, %.1f games/s\n", seconds, games.size() / seconds);
+   return 0;
+}
@@ -0,0 +1,184 @@
+#include "tuner.hpp"
+
+// Includes
+
+#include "util/file.hpp"
+#include "util/thread_pool.hpp"
+#include "bot.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <random>
+
+using namespace std::string_literals;
+
+// Constants
+
+namespace {
+   constexpr Vector2 single_mode_grid {12, 22};
+   constexpr BotLevel tuning_level {1e3f, 0.f, 400, 6};
+   constexpr float starting_deviation = .5f;
+   constexpr float extra_noise = .1f;
+   constexpr int weight_count = 5;
+
+   using Weights = std::array<float, weight_count>;
+
+   BotWeights to_bot_weights(const Weights& weights) {
+      return {weights[0], weights[1], weights[2], weights[3], weights[4]};
+   }
+
+   Weights from_bot_weights(const BotWeights& weights) {
+      return {weights.height, weights.holes, weights.bumpiness, weights.wells, weights.lines};
+   }
+
+   // Tuner state, everything a run needs to continue where it stopped
+
+   struct TunerState {
+      int generation = 0;
+      float best_score = -std::numeric_limits<float>::infinity();
+      Weights mean = from_bot_weights({}), deviation, best = mean;
+
+      TunerState() {
+         deviation.fill(starting_deviation);
+      }
+   };
+
+   void save_checkpoint(const std::string& file, const TunerState& state) {
+      std::string temporary = file + ".tmp"s;
+      {
+         std::ofstream f {temporary};
+         f.precision(std::numeric_limits<float>::max_digits10);
+         f << state.generation << '\n' << state.best_score << '\n';
+         for (const auto& weights : {state.mean, state.deviation, state.best}) {
+            for (auto w : weights) {
+               f << w << '\n';
+            }
+         }
+      }
+      std::rename(temporary.c_str(), file.c_str());
+   }
+
+   bool load_checkpoint(const std::string& file, TunerState& state) {
+      auto values = read_from_file(file, {});
+      if (values.size() != 2 + weight_count * 3) {
+         return false;
+      }
+      state.generation = values[0];
+      state.best_score = values[1];
+      for (int i = 0; i < weight_count; ++i) {
+         state.mean[i] = values[2 + i];
+         state.deviation[i] = values[2 + weight_count + i];
+         state.best[i] = values[2 + weight_count * 2 + i];
+      }
+      return true;
+   }
+
+   // Play game, a single player game where the bot's placement is locked with a hard drop,
+   // so the score follows the game's own clearing and scoring rules
+
+   float play_game(const BotWeights& weights, unsigned int seed, int max_pieces) {
+      Simulation sim(single_mode_grid, 1, false, seed);
+      Player& player = sim.players[0];
+      TranspositionTable table;
+
+      while (not sim.lost and player.pieces < max_pieces) {
+         Input input = place_best(sim, player, weights, tuning_level, table);
+         if (not input.held) {
+            break;
+         }
+         sim.step({input}, tick_time);
+         sim.sounds.clear();
+      }
+      return sim.score;
+   }
+}
+
+// Run tuner
+
+int run_tuner(const TunerConfig& config) {
+   TunerState state;
+   if (load_checkpoint(config.checkpoint, state)) {
+      std::printf("resuming from %s at generation %d\n", config.checkpoint.c_str(), state.generation);
+   }
+
+   ThreadPool pool {config.threads};
+   int elite_count = std::max(1, config.population / 4);
+   std::printf("tuning on %d threads, %d candidates of %d games each\n", pool.size(), config.population, config.games);
+   std::fflush(stdout);
+
+   for (; state.generation < config.generations; ++state.generation) {
+      // Every generation draws from its own seed so a resumed run plays the same games
+
+      std::mt19937 rng {config.seed * 1000003u + state.generation};
+      std::vector<Weights> candidates (config.population);
+      for (auto& candidate : candidates) {
+         for (int i = 0; i < weight_count; ++i) {
+            candidate[i] = std::normal_distribution<float>(state.mean[i], state.deviation[i])(rng);
+         }
+      }
+
+      std::vector<unsigned int> seeds (config.games);
+      for (auto& seed : seeds) {
+         seed = rng();
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      std::vector<float> scores (config.population * config.games);
+      for (int c = 0; c < config.population; ++c) {
+         for (int g = 0; g < config.games; ++g) {
+            pool.submit([&, c, g] { scores[c * config.games + g] = play_game(to_bot_weights(candidates[c]), seeds[g], config.max_pieces); });
+         }
+      }
+      pool.wait();
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      std::vector<float> averages (config.population);
+      for (int c = 0; c < config.population; ++c) {
+         averages[c] = std::accumulate(scores.begin() + c * config.games, scores.begin() + (c + 1) * config.games, 0.f) / config.games;
+      }
+
+      std::vector<int> order (config.population);
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return averages[a] > averages[b]; });
+
+      if (averages[order[0]] > state.best_score) {
+         state.best_score = averages[order[0]];
+         state.best = candidates[order[0]];
+      }
+
+      // Move the mean and deviation to the elite, with extra noise that fades out so the
+      // search doesn't collapse early
+
+      float noise = extra_noise * (1.f - float(state.generation) / config.generations);
+      for (int i = 0; i < weight_count; ++i) {
+         float mean = 0, variance = 0;
+         for (int e = 0; e < elite_count; ++e) {
+            mean += candidates[order[e]][i] / elite_count;
+         }
+         for (int e = 0; e < elite_count; ++e) {
+            variance += std::pow(candidates[order[e]][i] - mean, 2.f) / elite_count;
+         }
+         state.mean[i] = mean;
+         state.deviation[i] = std::sqrt(variance) + noise;
+      }
+
+      std::printf("generation %d: %zu games in %.1fs (%.1f games/s), best %.0f, elite mean %.0f, all-time best %.0f\n",
+         state.generation + 1, scores.size(), seconds, scores.size() / seconds, averages[order[0]],
+         std::accumulate(order.begin(), order.begin() + elite_count, 0.f, [&](float sum, int c) { return sum + averages[c]; }) / elite_count,
+         state.best_score);
+      std::fflush(stdout);
+
+      TunerState saved = state;
+      saved.generation++;
+      save_checkpoint(config.checkpoint, saved);
+   }
+
+   const auto& best = state.best;
+   std::printf("best weights: height %.4f, holes %.4f, bumpiness %.4f, wells %.4f, lines %.4f\n", best[0], best[1], best[2], best[3], best[4]);
+   return 0;
+}
@@ -3,6 +3,10 @@
 // Includes
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <random>
 #include <raylib.h>
 #include <filesystem>
@@ -16,6 +20,52 @@ static std::vector<std::string> music_pool, music_bag;
 static Music current_song;
 static float music_volume = 1.f, sound_volume = 1.f;
 
+// Latency measurement, the mixer runs on the audio thread so its side only touches atomics
+
+using Clock = std::chrono::steady_clock;
+constexpr int max_mixer_samples = 1 << 14;
+
+static bool measuring = false;
+static Clock::time_point key_press_time;
+static bool key_pressed = false;
+static std::vector<float> input_to_play;
+static std::atomic<std::int64_t> pending_play = 0;
+static std::atomic<std::int64_t> last_mix = 0;
+static std::atomic<int> mixer_samples = 0;
+static std::array<std::atomic<float>, max_mixer_samples> play_to_mix, mix_period;
+static std::atomic<unsigned int> mix_frames = 0;
+
+static std::int64_t now_ns() {
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static void on_mixed(void*, unsigned int frames) {
+   std::int64_t now = now_ns();
+   std::int64_t previous = last_mix.exchange(now, std::memory_order_relaxed);
+   std::int64_t played = pending_play.exchange(0, std::memory_order_acquire);
+   mix_frames.store(frames, std::memory_order_relaxed);
+
+   if (played == 0 or previous == 0) {
+      return;
+   }
+   int i = mixer_samples.load(std::memory_order_relaxed);
+   if (i < max_mixer_samples) {
+      play_to_mix[i].store((now - played) / 1e6f, std::memory_order_relaxed);
+      mix_period[i].store((now - previous) / 1e6f, std::memory_order_relaxed);
+      mixer_samples.store(i + 1, std::memory_order_release);
+   }
+}
+
+static void print_distribution(const char* name, std::vector<float> samples) {
+   if (samples.empty()) {
+      std::printf("  %-14s no samples\n", name);
+      return;
+   }
+   std::sort(samples.begin(), samples.end());
+   auto at = [&](float q) { return samples[std::min<std::size_t>(samples.size() * q, samples.size() - 1)]; };
+   std::printf("  %-14s p50 %6.2f  p90 %6.2f  p99 %6.2f  max %6.2f  (%zu)\n", name, at(.5f), at(.9f), at(.99f), samples.back(), samples.size());
+}
+
 // Load/unload functions
 
 void load_audio() {   
@@ -49,8 +99,18 @@ void set_sound_volume(float volume) {
 }
 
 void play_audio(const std::string& name) {
-   PlaySound(sounds[name]);
    SetSoundVolume(sounds[name], sound_volume);
+   PlaySound(sounds[name]);
+
+   if (measuring) {
+      auto now = Clock::now();
+      if (key_pressed) {
+         input_to_play.push_back(std::chrono::duration<float, std::milli>(now - key_press_time).count());
+         key_pressed = false;
+      }
+      std::int64_t expected = 0;
+      pending_play.compare_exchange_strong(expected, now_ns(), std::memory_order_release);
+   }
 }
 
 // Music functions
@@ -87,3 +147,39 @@ void update_music() {
    }
    UpdateMusicStream(current_song);
 }
+
+// Latency functions
+
+void start_latency_measurement() {
+   measuring = true;
+   AttachAudioMixedProcessor(on_mixed);
+}
+
+void stop_latency_measurement() {
+   if (not measuring) {
+      return;
+   }
+   DetachAudioMixedProcessor(on_mixed);
+   measuring = false;
+
+   int count = mixer_samples.load(std::memory_order_acquire);
+   std::vector<float> to_mix, periods;
+   for (int i = 0; i < count; ++i) {
+      to_mix.push_back(play_to_mix[i].load(std::memory_order_relaxed));
+      periods.push_back(mix_period[i].load(std::memory_order_relaxed));
+   }
+   std::printf("Audio latency in ms, the device buffer adds to this:\n");
+   print_distribution("key to play", input_to_play);
+   print_distribution("play to mix", to_mix);
+   print_distribution("mix period", periods);
+   std::printf("  %u frames per mix\n", mix_frames.load(std::memory_order_relaxed));
+}
+
+// A press only counts toward a sound played in the same frame, so this is called every frame
+
+void note_input(bool pressed) {
+   if (measuring) {
+      key_press_time = Clock::now();
+      key_pressed = pressed;
+   }
+}
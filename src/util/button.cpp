@@ -30,6 +30,12 @@ void Button::update() {
    }
 }
 
+// Resting, the scale has reached where the hover and press animations take it
+
+bool Button::resting() const {
+   return scale == (down ? .9f : hovering ? 1.1f : 1.f);
+}
+
 // Render button
 
 void Button::draw() {
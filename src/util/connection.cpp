@@ -0,0 +1,69 @@
+#include "util/connection.hpp"
+
+// Includes
+
+#include "util/bytes.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Connection functions
+
+// Listen on a port, returns a non-blocking listening socket or -1
+
+int listen_on(int port) {
+   int fd = socket(AF_INET, SOCK_STREAM, 0);
+   if (fd < 0) {
+      return -1;
+   }
+
+   int reuse = 1;
+   setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+   fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+   sockaddr_in address {};
+   address.sin_family = AF_INET;
+   address.sin_addr.s_addr = htonl(INADDR_ANY);
+   address.sin_port = htons(port);
+
+   if (bind(fd, (sockaddr*)&address, sizeof(address)) < 0 or listen(fd, SOMAXCONN) < 0) {
+      close(fd);
+      return -1;
+   }
+   return fd;
+}
+
+void queue_message(Connection& connection, const std::vector<unsigned char>& payload) {
+   ByteWriter writer;
+   writer.write<std::uint32_t>(payload.size());
+   connection.pending.insert(connection.pending.end(), writer.data.begin(), writer.data.end());
+   connection.pending.insert(connection.pending.end(), payload.begin(), payload.end());
+}
+
+// Flush, sends whatever the socket accepts. Returns false once the peer is gone.
+
+bool flush_connection(Connection& connection) {
+   size_t offset = 0;
+   while (offset < connection.pending.size()) {
+      ssize_t sent = send(connection.fd, connection.pending.data() + offset, connection.pending.size() - offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+      if (sent < 0) {
+         connection.pending.erase(connection.pending.begin(), connection.pending.begin() + offset);
+         return errno == EAGAIN or errno == EWOULDBLOCK;
+      }
+      offset += sent;
+   }
+   connection.pending.clear();
+   return true;
+}
+
+void close_connection(Connection& connection) {
+   if (connection.fd >= 0) {
+      close(connection.fd);
+   }
+   connection.fd = -1;
+   connection.pending.clear();
+}
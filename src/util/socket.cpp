@@ -0,0 +1,128 @@
+#include "util/socket.hpp"
+
+// Includes
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Constants
+
+namespace {
+   constexpr int max_packet_size = 1024;
+
+   double now() {
+      return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+   }
+}
+
+// Destructor
+
+UdpSocket::~UdpSocket() {
+   close();
+}
+
+// Open socket
+
+bool UdpSocket::open(int port, const std::string& host, int host_port) {
+   close();
+   if (not resolve_host(host, peer_address)) {
+      return false;
+   }
+   fd = socket(AF_INET, SOCK_DGRAM, 0);
+   if (fd < 0) {
+      return false;
+   }
+   fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+   sockaddr_in address {};
+   address.sin_family = AF_INET;
+   address.sin_addr.s_addr = htonl(INADDR_ANY);
+   address.sin_port = htons(port);
+
+   if (bind(fd, (sockaddr*)&address, sizeof(address)) < 0) {
+      close();
+      return false;
+   }
+   peer_port = host_port;
+   return true;
+}
+
+// Close socket
+
+void UdpSocket::close() {
+   if (fd >= 0) {
+      ::close(fd);
+   }
+   fd = -1;
+   outgoing.clear();
+}
+
+// Send, queued for the injected latency and dropped at the injected loss rate
+
+void UdpSocket::send(const std::vector<unsigned char>& data) {
+   if (fd < 0 or std::uniform_real_distribution<float>(0.f, 1.f)(loss_rng) < loss) {
+      return;
+   }
+   outgoing.push_back({now() + latency, data});
+   flush();
+}
+
+// Receive one packet from the peer if available
+
+bool UdpSocket::receive(std::vector<unsigned char>& data) {
+   flush();
+   if (fd < 0) {
+      return false;
+   }
+
+   while (true) {
+      sockaddr_in from {};
+      socklen_t from_size = sizeof(from);
+      data.resize(max_packet_size);
+      ssize_t size = recvfrom(fd, data.data(), data.size(), 0, (sockaddr*)&from, &from_size);
+      if (size < 0) {
+         data.clear();
+         return false;
+      }
+
+      if (size > 0 and from.sin_addr.s_addr == peer_address and ntohs(from.sin_port) == peer_port) {
+         data.resize(size);
+         return true;
+      }
+   }
+}
+
+// Flush, sends queued packets whose latency has passed
+
+void UdpSocket::flush() {
+   sockaddr_in address {};
+   address.sin_family = AF_INET;
+   address.sin_port = htons(peer_port);
+   address.sin_addr.s_addr = peer_address;
+
+   double time = now();
+   while (not outgoing.empty() and outgoing.front().send_time <= time) {
+      const auto& data = outgoing.front().data;
+      sendto(fd, data.data(), data.size(), 0, (sockaddr*)&address, sizeof(address));
+      outgoing.pop_front();
+   }
+}
+
+// Resolve host
+
+bool resolve_host(const std::string& host, unsigned int& address) {
+   addrinfo hints {};
+   hints.ai_family = AF_INET;
+   addrinfo* result = nullptr;
+   if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 or not result) {
+      return false;
+   }
+   address = reinterpret_cast<sockaddr_in*>(result->ai_addr)->sin_addr.s_addr;
+   freeaddrinfo(result);
+   return true;
+}
@@ -0,0 +1,108 @@
+#include "util/thread_pool.hpp"
+
+// Includes
+
+#include <algorithm>
+
+// Constructor and destructor
+
+ThreadPool::ThreadPool(int thread_count) {
+   if (thread_count <= 0) {
+      thread_count = std::max(1u, std::thread::hardware_concurrency());
+   }
+
+   for (int i = 0; i < thread_count; ++i) {
+      queues.push_back(std::make_unique<Queue>());
+   }
+   for (int i = 0; i < thread_count; ++i) {
+      workers.emplace_back(&ThreadPool::run, this, i);
+   }
+}
+
+ThreadPool::~ThreadPool() {
+   {
+      std::lock_guard lock {mutex};
+      running = false;
+   }
+   task_added.notify_all();
+   for (auto& worker : workers) {
+      worker.join();
+   }
+}
+
+// Submit, queues are filled in turn so every worker starts with its share
+
+void ThreadPool::submit(std::function<void()> task) {
+   Queue* queue;
+   {
+      std::lock_guard lock {mutex};
+      queue = queues[next_queue].get();
+      next_queue = (next_queue + 1) % queues.size();
+      pending++;
+   }
+   {
+      std::lock_guard lock {queue->mutex};
+      queue->tasks.push_back(std::move(task));
+   }
+   {
+      std::lock_guard lock {mutex};
+      queued++;
+   }
+   task_added.notify_one();
+}
+
+// Wait, blocks until every submitted task has finished
+
+void ThreadPool::wait() {
+   std::unique_lock lock {mutex};
+   tasks_done.wait(lock, [this] { return pending == 0; });
+}
+
+int ThreadPool::size() const {
+   return workers.size();
+}
+
+// Pop, own queue from the back, then the other queues from the front
+
+bool ThreadPool::pop(int index, std::function<void()>& task) {
+   for (int i = 0; i < queues.size(); ++i) {
+      auto& queue = *queues[(index + i) % queues.size()];
+      std::lock_guard lock {queue.mutex};
+      if (queue.tasks.empty()) {
+         continue;
+      }
+
+      if (i == 0) {
+         task = std::move(queue.tasks.back());
+         queue.tasks.pop_back();
+      } else {
+         task = std::move(queue.tasks.front());
+         queue.tasks.pop_front();
+      }
+      queued--;
+      return true;
+   }
+   return false;
+}
+
+// Run, the worker loop
+
+void ThreadPool::run(int index) {
+   while (true) {
+      std::function<void()> task;
+      if (not pop(index, task)) {
+         std::unique_lock lock {mutex};
+         task_added.wait(lock, [this] { return queued > 0 or not running; });
+         if (not running) {
+            return;
+         }
+         continue;
+      }
+      task();
+
+      if (--pending == 0) {
+         std::lock_guard lock {mutex};
+         tasks_done.notify_all();
+      }
+   }
+}